@@ -4,15 +4,28 @@
 #include "core/os/os.h"
 #include "core/os/dir_access.h"
 #include "core/os/file_access.h"
+#include "core/io/file_access_pack.h"
 #include "core/math/math_funcs.h"
-#include "handle_map.h"
+#include "core/project_settings.h"
 
 #include <sys/stat.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <stdarg.h>
+#include <algorithm>
+#include <functional>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#if defined(UNIX_ENABLED)
+#include <sys/mman.h>
+#include <unistd.h>
+#define PYFILE_MMAP_ENABLED
+#endif
 
 #define SUCCESS (0)
 #define FAILURE (-1)
@@ -76,8 +89,37 @@ static int _conv_perm(const String &p_path, const String &mode) {
 	return flags;
 }
 
-struct PYFILE {
+static void _stat_changed(); // files are modified
+
+#ifndef PYFILE_BUFSIZE
+#define PYFILE_BUFSIZE 8192
+#endif
+
+// FileAccess with a user-space buffer. Buffer holds either bytes read ahead
+// (FileAccess is positioned after them) or bytes not written yet (FileAccess
+// is positioned before them), any other operation syncs it first.
+struct PYFILE : _gd_filebuf {
+	enum {
+		PUSHBACK = 8, // room for ungetc before the buffered bytes
+	};
+	enum BufferState {
+		BUFFER_NONE,
+		BUFFER_READ,
+		BUFFER_WRITE,
+	};
+
 	FileAccess *fa;
+	int fd; // descriptor in _fds or -1
+	int streams; // fopen and every fdopen, 0 if opened by open() (guarded by _fds)
+	int flags; // FileAccess::ModeFlags
+	uint8_t *buffer;
+	size_t size; // 0 - unbuffered
+	size_t wlen; // pending bytes
+	BufferState state;
+	bool line_buffered;
+	bool pushed; // window modified by ungetc
+	bool eof;
+
 	static String fixpath(const String &p_path) {
 		if (_current_dir
 			&& !p_path.is_abs_path()
@@ -95,7 +137,10 @@ struct PYFILE {
 				if (flags & EX_MODE_APPEND) {
 					_fa->seek_end();
 				}
-				return memnew(PYFILE(_fa));
+				if ((flags & 0xff) != FileAccess::READ) {
+					_stat_changed();
+				}
+				return memnew(PYFILE(_fa, flags));
 			} else {
 				return nullptr;
 			}
@@ -110,100 +155,410 @@ struct PYFILE {
 				if (flags & EX_MODE_APPEND) {
 					_fa->seek_end();
 				}
-				return memnew(PYFILE(_fa));
+				if ((flags & 0xff) != FileAccess::READ) {
+					_stat_changed();
+				}
+				return memnew(PYFILE(_fa, flags));
 			} else {
 				return nullptr;
 			}
 		}
 		return nullptr;
 	}
-	PYFILE(FileAccess *p_fa) {
+
+	_FORCE_INLINE_ uint8_t *data() const { return buffer + PUSHBACK; }
+
+	void reset() {
+		rbase = buffer;
+		rpos = rend = buffer ? data() : nullptr;
+		pushed = false;
+	}
+
+	void set_buffer(size_t p_size, bool p_line) {
+		sync();
+		if (buffer) {
+			memdelete_arr(buffer);
+			buffer = nullptr;
+		}
+		size = fa ? p_size : 0;
+		if (size) {
+			buffer = memnew_arr(uint8_t, PUSHBACK + size);
+		}
+		line_buffered = p_line;
+		reset();
+	}
+
+	// Drop bytes read ahead and write pending bytes
+	void sync() {
+		if (state == BUFFER_READ) {
+			const uint64_t unread = rend - rpos;
+			if (unread) {
+				const uint64_t pos = fa->get_position();
+				fa->seek(pos > unread ? pos - unread : 0);
+			}
+			reset();
+		} else if (state == BUFFER_WRITE) {
+			if (wlen) {
+				fa->store_buffer(data(), wlen);
+				wlen = 0;
+			}
+		}
+		state = BUFFER_NONE;
+	}
+
+	// Next chunk to the (empty) read window
+	size_t fill() {
+		if (state != BUFFER_READ) {
+			sync();
+			state = BUFFER_READ;
+		}
+		const size_t n = fa->get_buffer(data(), size);
+		rpos = data();
+		rend = rpos + n;
+		pushed = false;
+		eof = fa->eof_reached();
+		return n;
+	}
+
+	uint64_t tell() const {
+		switch (state) {
+			case BUFFER_READ: {
+				const uint64_t pos = fa->get_position(), unread = rend - rpos;
+				return pos > unread ? pos - unread : 0;
+			}
+			case BUFFER_WRITE: return fa->get_position() + wlen;
+			default: return fa->get_position();
+		}
+	}
+
+	bool seek(int64_t p_offset, int p_whence) {
+		if (p_whence == SEEK_CUR) {
+			p_offset += tell();
+			p_whence = SEEK_SET;
+		}
+		if (p_whence == SEEK_SET && state == BUFFER_READ && !pushed) {
+			// target is inside the read window
+			const int64_t end = fa->get_position(), start = end - (rend - data());
+			if (p_offset >= start && p_offset <= end) {
+				rpos = rend - (end - p_offset);
+				eof = false;
+				return true;
+			}
+		}
+		sync();
+		switch (p_whence) {
+			case SEEK_SET: fa->seek(p_offset); break;
+			case SEEK_END: fa->seek_end(p_offset); break;
+			default: return false;
+		}
+		eof = false;
+		return true;
+	}
+
+	size_t read(uint8_t *p_dst, size_t p_len) {
+		size_t done = 0;
+		while (done < p_len) {
+			const size_t avail = rend - rpos;
+			if (avail) {
+				const size_t n = MIN(avail, p_len - done);
+				memcpy(p_dst + done, rpos, n);
+				rpos += n;
+				done += n;
+			} else if (p_len - done >= size) {
+				// large reads go directly to the destination
+				sync();
+				done += fa->get_buffer(p_dst + done, p_len - done);
+				eof = fa->eof_reached();
+				break;
+			} else if (fill() == 0) {
+				break;
+			}
+		}
+		return done;
+	}
+
+	size_t write(const uint8_t *p_src, size_t p_len) {
+		if (p_len == 0) {
+			return 0;
+		}
+		if (state != BUFFER_WRITE) {
+			sync();
+			state = BUFFER_WRITE;
+		}
+		if (wlen + p_len > size) {
+			sync();
+			state = BUFFER_WRITE;
+		}
+		if (p_len >= size) {
+			fa->store_buffer(p_src, p_len);
+		} else {
+			memcpy(data() + wlen, p_src, p_len);
+			wlen += p_len;
+			if (line_buffered && memchr(p_src, '\n', p_len)) {
+				sync();
+			}
+		}
+		return p_len;
+	}
+
+	// Bytes up to and including '\n' (at most p_max), copied straight from
+	// the read window
+	size_t read_line(uint8_t *p_dst, size_t p_max) {
+		size_t done = 0;
+		while (done < p_max) {
+			if (rpos == rend) {
+				if (size == 0) {
+					const int c = getc();
+					if (c == EOF) {
+						break;
+					}
+					p_dst[done++] = c;
+					if (c == '\n') {
+						break;
+					}
+					continue;
+				} else if (fill() == 0) {
+					break;
+				}
+			}
+			const size_t avail = MIN(size_t(rend - rpos), p_max - done);
+			const uint8_t *nl = (const uint8_t *)memchr(rpos, '\n', avail);
+			const size_t n = nl ? nl - rpos + 1 : avail;
+			memcpy(p_dst + done, rpos, n);
+			rpos += n;
+			done += n;
+			if (nl) {
+				break;
+			}
+		}
+		return done;
+	}
+
+	int getc() {
+		if (rpos < rend) {
+			return *rpos++;
+		}
+		if (size == 0) {
+			sync();
+			const int b = fa->get_8();
+			eof = fa->eof_reached();
+			return eof ? EOF : b;
+		}
+		return fill() ? *rpos++ : EOF;
+	}
+
+	int ungetc(int c) {
+		if (c == EOF) {
+			return EOF;
+		}
+		if (size == 0) {
+			const uint64_t cur = fa->get_position();
+			if (cur) {
+				fa->seek(cur - 1);
+				eof = false;
+				return c;
+			}
+			return EOF;
+		}
+		if (state != BUFFER_READ) {
+			sync();
+			state = BUFFER_READ;
+		}
+		if (rpos == rbase) {
+			return EOF; // pushback area is full
+		}
+		*--rpos = uint8_t(c);
+		pushed = true;
+		eof = false;
+		return c;
+	}
+
+	_FORCE_INLINE_ bool at_eof() const { return rpos < rend ? false : eof; }
+
+	void close() {
+		sync();
+		fa->close();
+		if (flags != FileAccess::READ) {
+			_stat_changed();
+		}
+	}
+
+	PYFILE(FileAccess *p_fa, int p_flags) {
 		fa = p_fa;
+		fd = -1;
+		streams = 1;
+		flags = p_flags;
+		buffer = nullptr;
+		size = wlen = 0;
+		state = BUFFER_NONE;
+		line_buffered = eof = false;
+		set_buffer(PYFILE_BUFSIZE, false);
 	}
-	PYFILE() {
+	explicit PYFILE(int p_std_fd) { // standard streams
 		fa = nullptr;
+		fd = p_std_fd;
+		streams = 1;
+		flags = 0;
+		buffer = nullptr;
+		size = wlen = 0;
+		state = BUFFER_NONE;
+		line_buffered = eof = false;
+		reset();
 	}
 	~PYFILE() {
 		if (fa) {
+			sync();
 			memdelete(fa);
 		}
+		if (buffer) {
+			memdelete_arr(buffer);
+		}
 	}
 };
 
-static PYFILE gd_stdin;
-static PYFILE gd_stdout;
-static PYFILE gd_stderr;
+static PYFILE gd_stdin(0);
+static PYFILE gd_stdout(1);
+static PYFILE gd_stderr(2);
+
+// Descriptors of PYFILEs (0-2 are the standard streams). PYFILE keeps its
+// own descriptor, so lookups are O(1) both ways. Closed descriptors are
+// reused lowest first, like POSIX does. Descriptors start far above the
+// OS range, so native calls made with them (fstat, ftruncate, isatty in
+// fileobject.c) fail with EBADF instead of touching an unrelated file.
+static struct _FileTable {
+	enum {
+		FIRST_FD = 1 << 30,
+	};
+
+	std::mutex mutex; // descriptors are used outside the interpreter lock
+	std::vector<PYFILE *> files; // by fd - FIRST_FD
+	std::vector<int> free_fds; // min-heap
+
+	int attach(PYFILE *f) {
+		std::lock_guard<std::mutex> lock(mutex);
+		if (f->fd >= 0) {
+			return f->fd;
+		}
+		if (free_fds.empty()) {
+			f->fd = FIRST_FD + int(files.size());
+			files.push_back(f);
+		} else {
+			std::pop_heap(free_fds.begin(), free_fds.end(), std::greater<int>());
+			f->fd = free_fds.back();
+			free_fds.pop_back();
+			files[f->fd - FIRST_FD] = f;
+		}
+		return f->fd;
+	}
 
-static handle_map<PYFILE*> _handles(1, 32);
+	// close() of the descriptor or fclose() of a stream (closes the
+	// descriptor too, like POSIX does), true if it was the last owner
+	bool release(PYFILE *f, bool p_stream) {
+		std::lock_guard<std::mutex> lock(mutex);
+		if (f->fd >= FIRST_FD) {
+			files[f->fd - FIRST_FD] = nullptr;
+			free_fds.push_back(f->fd);
+			std::push_heap(free_fds.begin(), free_fds.end(), std::greater<int>());
+			f->fd = -1;
+		}
+		if (p_stream) {
+			f->streams--;
+		}
+		return f->streams <= 0;
+	}
+
+	PYFILE *_get(int fd) {
+		if (fd >= FIRST_FD && size_t(fd - FIRST_FD) < files.size()) {
+			if (PYFILE *f = files[fd - FIRST_FD]) {
+				return f;
+			}
+		}
+		errno = EBADF;
+		return nullptr;
+	}
+
+	PYFILE *get(int fd) {
+		switch (fd) {
+			case 0: return &gd_stdin;
+			case 1: return &gd_stdout;
+			case 2: return &gd_stderr;
+		}
+		std::lock_guard<std::mutex> lock(mutex);
+		return _get(fd);
+	}
+
+	// New owner of the descriptor's PYFILE (fdopen)
+	PYFILE *retain(int fd) {
+		if (fd >= 0 && fd <= 2) {
+			return get(fd); // standard streams are never closed
+		}
+		std::lock_guard<std::mutex> lock(mutex);
+		PYFILE *f = _get(fd);
+		if (f) {
+			f->streams++;
+		}
+		return f;
+	}
+} _fds;
+
+// PYFILE is shared by its descriptor and streams, closed with the last one
+static void _delete_file(PYFILE *f, bool p_stream) {
+	if (_fds.release(f, p_stream)) {
+		f->close();
+		memdelete(f);
+	}
+}
 
 int _gd_open(const char* name, int flags, ...) {
 	PYFILE *f = PYFILE::fopen(name, flags);
 	if (f) {
-		return _handles.insert(f).value;
+		f->streams = 0;
+		return _fds.attach(f);
 	}
-	return 0;
+	errno = ENOENT;
+	return FAILURE;
 }
 
 int _gd_close(int fd) {
-	if (fd > 0) {
-		const Id_T t =  make_handle(fd);
-		if (_handles.is_valid(t)) {
-			PYFILE *f = _handles[t];
-			f->fa->close();
-			_handles.erase(t);
-			memdelete(f);
-			return 0;
-		}
+	PYFILE *f = _fds.get(fd);
+	if (f && f->fa) {
+		_delete_file(f, false);
+		return SUCCESS;
 	}
 	return FAILURE;
 }
 
 int _gd_lseek(int fd, off_t offset, int whence) {
-	if (fd > 0) {
-		const Id_T t =  make_handle(fd);
-		if (_handles.is_valid(t)) {
-			return _gd_fseek(_handles[t], offset, whence);
-		}
+	if (PYFILE *f = _fds.get(fd)) {
+		return _gd_fseek(f, offset, whence);
 	}
 	return FAILURE;
 }
 
 off_t _gd_ltell(int fd) {
-	if (fd > 0) {
-		const Id_T t =  make_handle(fd);
-		if (_handles.is_valid(t)) {
-			return _gd_ftell(_handles[t]);
-		}
+	if (PYFILE *f = _fds.get(fd)) {
+		return _gd_ftell(f);
 	}
-	return 0;
+	return FAILURE;
 }
 
 ssize_t _gd_read(int fd, void* buf, size_t len) {
-	if (fd > 0) {
-		const Id_T t =  make_handle(fd);
-		if (_handles.is_valid(t)) {
-			return _gd_fread(buf, len, 1, _handles[t]);
-		}
+	if (PYFILE *f = _fds.get(fd)) {
+		return _gd_fread(buf, 1, len, f);
 	}
-	return 0;
+	return FAILURE;
 }
 
 ssize_t _gd_write(int fd, const void* buf, size_t len) {
-	if (fd > 0) {
-		const Id_T t =  make_handle(fd);
-		if (_handles.is_valid(t)) {
-			return _gd_fwrite(buf, len, 1, _handles[t]);
-		}
+	if (PYFILE *f = _fds.get(fd)) {
+		return _gd_fwrite(buf, 1, len, f);
 	}
-	return 0;
+	return FAILURE;
 }
 
 ssize_t _gd_filesize(int fd) {
-	if (fd > 0) {
-		const Id_T t =  make_handle(fd);
-		if (_handles.is_valid(t)) {
-			return _gd_ffilesize(_handles[t]);
-		}
+	if (PYFILE *f = _fds.get(fd)) {
+		return _gd_ffilesize(f);
 	}
 	return FAILURE;
 }
@@ -216,22 +571,105 @@ PYFILE *_gd_wfopen(const wchar_t *name, const wchar_t *mode) {
 	return PYFILE::fopen(String(name), String(mode));
 }
 
+// Stream shares the PYFILE with the descriptor, freed with the last stream
 PYFILE *_gd_fdopen(const int fd, const char *mode) {
-	if (fd > 0) {
-		const Id_T t = make_handle(fd);
-		if (_handles.is_valid(t)) {
-			return _handles[t];
-		}
+	return _fds.retain(fd);
+}
+
+// OS path of a file not served from a PCK (empty if there is none)
+static String _os_path(const String &p_path) {
+	const String path = PYFILE::fixpath(p_path);
+	PackedData *packed = PackedData::get_singleton();
+	if (packed && !packed->is_disabled() && packed->has_path(path)) {
+		return String();
 	}
-	return nullptr;
+	if (path.begins_with("res://") || path.begins_with("user://")) {
+		return ProjectSettings::get_singleton()->globalize_path(path);
+	}
+	return path.find("://") == -1 ? path : String();
 }
 
-static bool _is_link(const String &path) {
-	DirAccessRef da(DirAccess::create_for_path(path));
-	return da->is_link(path);
+static bool _fill_stat(const String &p_path, struct stat *r_st) {
+	memset(r_st, 0, sizeof(struct stat));
+	const String os_path = _os_path(p_path);
+	if (!os_path.empty() && ::stat(os_path.utf8().get_data(), r_st) == 0) {
+		return true;
+	}
+	if (DirAccess::exists(p_path)) {
+		r_st->st_mode = S_IFDIR | 0555;
+	} else if (FileAccess *fa = FileAccess::open(p_path, FileAccess::READ)) {
+		r_st->st_mode = S_IFREG | 0444;
+		r_st->st_size = fa->get_len();
+		memdelete(fa);
+	} else {
+		return false;
+	}
+	r_st->st_nlink = 1;
+	r_st->st_ctime = r_st->st_mtime = r_st->st_atime = FileAccess::get_modified_time(p_path);
+	return true;
+}
+
+// Existence and type of paths probed by imports (imports probe every
+// suffix in every sys.path entry). Only what probing needs is kept, stat()
+// and fstat() always ask the file system. Entries are valid for one
+// generation, the generation changes with every modification done through
+// this layer and posixmodule (rename, remove, rmdir, open).
+static struct _StatCache {
+	enum {
+		MAX_ENTRIES = 4096,
+	};
+
+	struct Entry {
+		uint64_t generation;
+		bool exists;
+		mode_t mode;
+	};
+
+	std::mutex mutex;
+	std::unordered_map<std::string, Entry> entries;
+	uint64_t generation = 1;
+	uint64_t probes = 0, hits = 0;
+
+	bool lookup(const char *p_path, mode_t *r_mode) {
+		const std::string key = p_path;
+		uint64_t gen;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			probes++;
+			auto it = entries.find(key);
+			if (it != entries.end() && it->second.generation == generation) {
+				hits++;
+				*r_mode = it->second.mode;
+				return it->second.exists;
+			}
+			gen = generation;
+		}
+		struct stat st;
+		Entry entry;
+		entry.generation = gen;
+		entry.exists = _fill_stat(p_path, &st);
+		entry.mode = st.st_mode;
+		std::lock_guard<std::mutex> lock(mutex);
+		if (entries.size() >= MAX_ENTRIES) {
+			entries.clear();
+		}
+		entries[key] = entry;
+		*r_mode = entry.mode;
+		return entry.exists;
+	}
+
+	void invalidate() {
+		std::lock_guard<std::mutex> lock(mutex);
+		generation++;
+	}
+} _stat_cache;
+
+static void _stat_changed() {
+	_stat_cache.invalidate();
 }
 
 int _gd_chdir(const char *dir) {
+	_stat_cache.invalidate(); // relative paths
 	if (!_current_dir) {
 		_current_dir = DirAccess::create_for_path(dir);
 	}
@@ -245,6 +683,7 @@ int _gd_chdir(const char *dir) {
 }
 
 int _gd_mkdir(const char *dir) {
+	_stat_cache.invalidate();
 	return DirAccess::create_for_path(dir)->make_dir(dir) == OK ? 0 : -1;
 }
 
@@ -263,85 +702,108 @@ char *_gd_getcwd(char *buf, int size) {
 }
 
 int _gd_unlink(const char *path) {
+	_stat_cache.invalidate();
 	DirAccessRef da(DirAccess::create_for_path(path));
 	return da->remove(path) == OK ? SUCCESS : FAILURE;
 }
 
 int _gd_fstatf(PYFILE *f, struct stat *buf) {
-	if (f) {
-		String path = f->fa->get_path();
-		if (DirAccess::exists(path)) { if (buf) buf->st_mode = S_IFDIR; }
-		else if (FileAccess::exists(path)) { if (buf) buf->st_mode = S_IFREG; }
-		else return FAILURE;
-#ifdef S_IFLNK
-		if (_is_link(path)) { if (buf) buf->st_mode = S_IFLNK; }
-#endif
-		if (buf) { buf->st_ctime = buf->st_mtime = FileAccess::get_modified_time(path); }
+	if (f && f->fa) {
+		// never cached: imports compare mtime of the open source file
+		struct stat st;
+		if (!_fill_stat(f->fa->get_path(), &st)) {
+			memset(&st, 0, sizeof(st));
+			st.st_mode = S_IFREG | 0644;
+		}
+		f->sync();
+		st.st_size = f->fa->get_len();
+		if (buf) {
+			*buf = st;
+		}
 		return SUCCESS;
 	}
 	return FAILURE;
 }
 
 int _gd_fstat(int fd, struct stat *buf) {
-	if (fd > 0) {
-		const Id_T t =  make_handle(fd);
-		if (_handles.is_valid(t)) {
-			return _gd_fstatf(_handles[t], buf);
-		}
+	if (PYFILE *f = _fds.get(fd)) {
+		return _gd_fstatf(f, buf);
 	}
 	return FAILURE;
 }
 
 int _gd_stat(const char *path, struct stat *buf) {
-	if (DirAccess::exists(path)) { if (buf) buf->st_mode = S_IFDIR; }
-	else if (FileAccess::exists(path)) { if (buf) buf->st_mode = S_IFREG; }
-	else return FAILURE;
-#ifdef S_IFLNK
-	if (_is_link(path)) { if (buf) buf->st_mode = S_IFLNK; }
-#endif
-	if (buf) {  buf->st_ctime = buf->st_mtime = FileAccess::get_modified_time(path); }
+	struct stat st;
+	if (!_fill_stat(path, &st)) {
+		errno = ENOENT;
+		return FAILURE;
+	}
+	if (buf) {
+		*buf = st;
+	}
+	return SUCCESS;
+}
+
+int _gd_probe(const char *path, struct stat *buf) {
+	mode_t mode;
+	if (!_stat_cache.lookup(path, &mode)) {
+		errno = ENOENT;
+		return FAILURE;
+	}
+	if (buf) {
+		memset(buf, 0, sizeof(struct stat));
+		buf->st_mode = mode;
+		buf->st_nlink = 1;
+	}
 	return SUCCESS;
 }
 
+void _gd_stat_cache_info(unsigned long long *probes, unsigned long long *hits, size_t *entries) {
+	std::lock_guard<std::mutex> lock(_stat_cache.mutex);
+	if (probes) {
+		*probes = _stat_cache.probes;
+	}
+	if (hits) {
+		*hits = _stat_cache.hits;
+	}
+	if (entries) {
+		*entries = _stat_cache.entries.size();
+	}
+}
+
+void _gd_stat_cache_invalidate() {
+	_stat_cache.invalidate();
+}
+
 int _gd_fclose(PYFILE *f) {
-	if (f) {
-		if (f->fa) {
-			f->fa->close();
-			return SUCCESS;
-		} else {
-			return FAILURE;
-		}
+	if (f && f->fa) {
+		_delete_file(f, true);
+		return SUCCESS;
 	}
 	return FAILURE;
 }
 
 int _gd_fseek(PYFILE *f, off_t offset, int whence) {
-	if (f) {
-		switch (whence) {
-			case SEEK_SET: f->fa->seek(offset); break;
-			case SEEK_CUR: f->fa->seek(f->fa->get_position() + offset); break;
-			case SEEK_END: f->fa->seek_end(offset); break;
-			default: return FAILURE;
-		}
-		return SUCCESS;
+	if (f && f->fa) {
+		return f->seek(offset, whence) ? SUCCESS : FAILURE;
 	}
 	return FAILURE;
 }
 
 off_t _gd_ftell(PYFILE *f) {
-	if (f) {
-		return f->fa->get_position();
+	if (f && f->fa) {
+		return f->tell();
 	}
 	return FAILURE;
 }
 
 void _gd_rewind(PYFILE *f) {
-	return f->fa->seek(0);
+	f->seek(0, SEEK_SET);
 }
 
 ssize_t _gd_fread(void* buf, size_t len, size_t cnt, PYFILE *f) {
-	if (f) {
-		return f->fa->get_buffer((uint8_t*)buf, cnt * len);
+	if (f && f->fa && len) {
+		return f->read((uint8_t*)buf, cnt * len) / len;
 	}
 	return SUCCESS;
 }
@@ -349,15 +811,15 @@ ssize_t _gd_fread(void* buf, size_t len, size_t cnt, PYFILE *f) {
 ssize_t _gd_fwrite(const void* buf, size_t len, size_t cnt, PYFILE *f) {
 	if (f) {
 		if (f->fa) {
-			f->fa->store_buffer((const uint8_t*)buf, cnt * len);
+			f->write((const uint8_t*)buf, cnt * len);
 		} else if (f == _gd_stdout()) {
 			if (OS::get_singleton()->is_stdout_verbose()) {
 				OS::get_singleton()->print("%s", CharString((const char*)buf, len*cnt).c_str());
 			}
-			return len * cnt;
+			return cnt;
 		} else if (f == _gd_stderr()) {
 			OS::get_singleton()->printerr("%s", CharString((const char*)buf, len*cnt).c_str());
-			return len * cnt;
+			return cnt;
 #ifdef PYSTDERR_TO_FILE
 			FileAccessRef log(FileAccess::open("py_stderr.txt", FileAccess::READ_WRITE));
 			if (log) {
@@ -371,7 +833,7 @@ ssize_t _gd_fwrite(const void* buf, size_t len, size_t cnt, PYFILE *f) {
 			WARN_PRINT("Undefined file access - text is lost.");
 			return 0;
 		}
-		return cnt * len;
+		return cnt;
 	}
 	return 0;
 }
@@ -408,7 +870,7 @@ void _gd_vfprintf(PYFILE *f, const char *format, va_list ap) {
 		va_end(list);
 
 		if (f->fa) {
-			f->fa->store_buffer((const uint8_t*)buffer, len);
+			f->write((const uint8_t*)buffer, len - 1); // without the trailing '\0'
 		} else if (f == _gd_stdout()) {
 			vfprintf(stdout, format, ap);
 		} else if (f == _gd_stderr()) {
@@ -432,9 +894,12 @@ void _gd_vfprintf(PYFILE *f, const char *format, va_list ap) {
 }
 
 char *_gd_fgets(char* buf, size_t len, PYFILE *f) {
-	if (f) {
-		const char *line = f->fa->get_line().utf8().get_data();
-		strncpy(buf, line, len);
+	if (f && f->fa && len > 0) {
+		const size_t n = f->read_line((uint8_t*)buf, len - 1);
+		if (n == 0) {
+			return nullptr;
+		}
+		buf[n] = '\0';
 		return buf;
 	}
 	return nullptr;
@@ -443,7 +908,7 @@ char *_gd_fgets(char* buf, size_t len, PYFILE *f) {
 int _gd_fputs(const char* buf, PYFILE *f) {
 	if (f) {
 		if (f->fa) {
-			f->fa->store_string(String(buf));
+			f->write((const uint8_t*)buf, strlen(buf));
 		} else if (f == _gd_stdout()) {
 			if (OS::get_singleton()->is_stdout_verbose()) {
 				OS::get_singleton()->print("%s", buf);
@@ -461,9 +926,8 @@ int _gd_fputs(const char* buf, PYFILE *f) {
 }
 
 int _gd_getc(PYFILE *f) {
-	if (f) {
-		const int b = f->fa->get_8();
-		return f->fa->eof_reached() ? EOF : b;
+	if (f && f->fa) {
+		return f->getc();
 	}
 	return EOF;
 }
@@ -471,7 +935,8 @@ int _gd_getc(PYFILE *f) {
 int _gd_putc(int ch, PYFILE *f) {
 	if (f) {
 		if (f->fa) {
-			f->fa->store_8(ch);
+			const uint8_t b = ch;
+			f->write(&b, 1);
 		} else if (f == _gd_stdout()) {
 			putchar(ch);
 		} else if (f == _gd_stderr()) {
@@ -487,16 +952,25 @@ int _gd_putc(int ch, PYFILE *f) {
 }
 
 int _gd_ungetc(int c, PYFILE *f) {
-	if (f) {
-		const uint64_t cur = f->fa->get_position();
-		if (cur) {
-			f->fa->seek(cur - 1);
-			return c;
-		}
+	if (f && f->fa) {
+		return f->ungetc(c);
 	}
 	return EOF;
 }
 
+int _gd_setvbuf(PYFILE *f, int mode, size_t size) {
+	if (f && f->fa) {
+		switch (mode) {
+			case _IONBF: f->set_buffer(0, false); break;
+			case _IOLBF: f->set_buffer(size ? size : BUFSIZ, true); break;
+			case _IOFBF: f->set_buffer(size ? size : BUFSIZ, false); break;
+			default: return FAILURE;
+		}
+		return SUCCESS;
+	}
+	return FAILURE;
+}
+
 PYFILE *_gd_tmpfile() {
 	Math::randomize();
 	const OS::Date dt = OS::get_singleton()->get_date();
@@ -508,6 +982,9 @@ PYFILE *_gd_tmpfile() {
 int _gd_fflush(PYFILE *f) {
 	if (f) {
 		if (f->fa) {
+			if (f->state == PYFILE::BUFFER_WRITE) {
+				f->sync();
+			}
 			f->fa->flush();
 		} else if (f == _gd_stdout()) {
 			fflush(stdout);
@@ -524,16 +1001,16 @@ int _gd_fflush(PYFILE *f) {
 }
 
 int _gd_fileno(PYFILE *f) {
-	Id_T h;
-	if (_handles.find(f, h)) {
-		return h.value;
+	if (f) {
+		return _fds.attach(f);
 	}
-	return _handles.insert(f).value;
+	errno = EBADF;
+	return FAILURE;
 }
 
 int _gd_feof(PYFILE *f) {
-	if (f) {
-		return f->fa->eof_reached();
+	if (f && f->fa) {
+		return f->at_eof();
 	}
 	return 1;
 }
@@ -544,15 +1021,275 @@ int _gd_ferror(PYFILE *f) {
 }
 
 void _gd_clearerr(PYFILE *f) {
+	if (f) {
+		f->eof = false;
+	}
 }
 
 ssize_t _gd_ffilesize(PYFILE *f) {
-	if (f) {
+	if (f && f->fa) {
+		if (f->state == PYFILE::BUFFER_WRITE) {
+			f->sync();
+		}
 		return f->fa->get_len();
 	}
 	return FAILURE;
 }
 
+// Read-only mappings of whole files, shared by path and unmapped with the
+// last reference. Files with own OS file are mapped directly, files served
+// from the main PCK are mapped at their offset in the pack. Files under
+// user:// are written by the application (a mapping of a truncated file
+// faults), they are read through buffers. A mapping of an OS file is shared
+// only while the file is unchanged (same inode, size and mtime).
+#ifdef PYFILE_MMAP_ENABLED
+struct _Mapping {
+	std::string path;
+	size_t size;
+	size_t skip; // data offset in the mapping (pack entries are not page aligned)
+	int refs;
+	dev_t dev;
+	ino_t ino;
+	time_t mtime;
+
+	bool matches(const struct stat &st) const {
+		return st.st_dev == dev && st.st_ino == ino && size_t(st.st_size) == size && st.st_mtime == mtime;
+	}
+};
+
+static std::mutex _mappings_mutex;
+static std::unordered_map<std::string, const unsigned char *> _mapped_paths;
+static std::unordered_map<const unsigned char *, _Mapping> _mappings;
+
+// Directory of the main pack, parsed once the same way PackedSourcePCK does
+// it (PackedData keeps the offsets private). The pack is the one given with
+// --main-pack or the one found next to (or embedded in) the executable.
+// Other pack formats (compressed or encrypted) are left to buffered reads.
+static struct _PackDirectory {
+	struct Entry {
+		uint64_t offset;
+		uint64_t size;
+	};
+
+	bool loaded = false;
+	String path; // OS path of the pack, empty if there is none
+	std::unordered_map<std::string, Entry> entries; // by res:// path
+
+	bool _parse(const String &p_pack) {
+		FileAccessRef f = FileAccess::open(p_pack, FileAccess::READ);
+		if (!f) {
+			return false;
+		}
+		if (f->get_32() != PACK_HEADER_MAGIC) {
+			// pack embedded at the end of the executable
+			f->seek_end();
+			f->seek(f->get_position() - 4);
+			if (f->get_32() != PACK_HEADER_MAGIC) {
+				return false;
+			}
+			f->seek(f->get_position() - 12);
+			const uint64_t ds = f->get_64();
+			f->seek(f->get_position() - ds - 8);
+			if (f->get_32() != PACK_HEADER_MAGIC) {
+				return false;
+			}
+		}
+		if (f->get_32() != PACK_FORMAT_VERSION) {
+			return false;
+		}
+		for (int i = 0; i < 3 + 16; i++) {
+			f->get_32(); // engine version, reserved
+		}
+		const uint32_t count = f->get_32();
+		for (uint32_t i = 0; i < count; i++) {
+			const uint32_t sl = f->get_32();
+			CharString cs;
+			cs.resize(sl + 1);
+			f->get_buffer((uint8_t *)cs.ptrw(), sl);
+			cs.ptrw()[sl] = 0;
+			String file;
+			file.parse_utf8(cs.get_data());
+			Entry entry;
+			entry.offset = f->get_64();
+			entry.size = f->get_64();
+			f->seek(f->get_position() + 16); // md5
+			if (f->eof_reached()) {
+				entries.clear();
+				return false;
+			}
+			entries[file.utf8().get_data()] = entry;
+		}
+		path = p_pack;
+		return true;
+	}
+
+	void load() {
+		loaded = true;
+		PackedData *packed = PackedData::get_singleton();
+		if (packed == nullptr || packed->is_disabled()) {
+			return;
+		}
+		Vector<String> packs;
+		const List<String> args = OS::get_singleton()->get_cmdline_args();
+		for (const List<String>::Element *E = args.front(); E; E = E->next()) {
+			if (E->get() == "--main-pack" && E->next()) {
+				packs.push_back(E->next()->get());
+			}
+		}
+		const String exec_path = OS::get_singleton()->get_executable_path();
+		if (!exec_path.empty()) {
+			const String dir = exec_path.get_base_dir();
+			const String file = exec_path.get_file();
+			packs.push_back(exec_path);
+			packs.push_back(dir.plus_file(file.get_basename() + ".pck"));
+			packs.push_back(dir.plus_file(file + ".pck"));
+			packs.push_back(file.get_basename() + ".pck");
+			packs.push_back(file + ".pck");
+		}
+		for (int i = 0; i < packs.size(); i++) {
+			if (_parse(packs[i])) {
+				return;
+			}
+		}
+	}
+
+	// Entry holds what PackedData serves (file is not replaced by a pack
+	// loaded later): same size and same leading bytes
+	static bool serves(const String &p_path, int p_fd, const Entry &p_entry) {
+		FileAccessRef fa = FileAccess::open(p_path, FileAccess::READ);
+		if (!fa || uint64_t(fa->get_len()) != p_entry.size) {
+			return false;
+		}
+		uint8_t served[64], packed[64];
+		const int n = MIN(p_entry.size, sizeof(served));
+		return fa->get_buffer(served, n) == n && ::pread(p_fd, packed, n, p_entry.offset) == n && memcmp(served, packed, n) == 0;
+	}
+} _pack;
+
+static const unsigned char *_mmap_packed(const String &p_path, size_t *size) {
+	const std::string key = p_path.utf8().get_data();
+	std::lock_guard<std::mutex> lock(_mappings_mutex);
+	auto it = _mapped_paths.find(key);
+	if (it != _mapped_paths.end()) { // pack does not change while running
+		_Mapping &m = _mappings[it->second];
+		m.refs++;
+		if (size) {
+			*size = m.size;
+		}
+		return it->second;
+	}
+	if (!_pack.loaded) {
+		_pack.load();
+	}
+	auto entry = _pack.entries.find(key);
+	if (entry == _pack.entries.end() || entry->second.size == 0) {
+		return nullptr;
+	}
+	const _PackDirectory::Entry &e = entry->second;
+	const int fd = ::open(_pack.path.utf8().get_data(), O_RDONLY);
+	if (fd < 0) {
+		return nullptr;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0 || e.offset + e.size > uint64_t(st.st_size) || !_pack.serves(p_path, fd, e)) {
+		::close(fd);
+		return nullptr;
+	}
+	const uint64_t page = sysconf(_SC_PAGESIZE);
+	const size_t skip = e.offset % page;
+	void *addr = ::mmap(nullptr, e.size + skip, PROT_READ, MAP_SHARED, fd, off_t(e.offset - skip));
+	::close(fd);
+	if (addr == MAP_FAILED) {
+		return nullptr;
+	}
+	const unsigned char *data = (const unsigned char *)addr + skip;
+	_mapped_paths[key] = data;
+	_mappings[data] = _Mapping{ key, size_t(e.size), skip, 1, st.st_dev, st.st_ino, st.st_mtime };
+	if (size) {
+		*size = e.size;
+	}
+	return data;
+}
+#endif
+
+const unsigned char *_gd_mmap(const char *path, size_t *size) {
+#ifdef PYFILE_MMAP_ENABLED
+	const String fixed = PYFILE::fixpath(path);
+	if (fixed.begins_with("user://")) {
+		return nullptr;
+	}
+	const String os_path = _os_path(path);
+	if (os_path.empty()) {
+		return _mmap_packed(fixed, size);
+	}
+	if (os_path.begins_with(OS::get_singleton()->get_user_data_dir())) {
+		return nullptr;
+	}
+	const std::string key = os_path.utf8().get_data();
+	const int fd = ::open(key.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return nullptr;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0) {
+		::close(fd);
+		return nullptr;
+	}
+	std::lock_guard<std::mutex> lock(_mappings_mutex);
+	auto it = _mapped_paths.find(key);
+	if (it != _mapped_paths.end()) {
+		_Mapping &m = _mappings[it->second];
+		if (m.matches(st)) {
+			::close(fd);
+			m.refs++;
+			if (size) {
+				*size = m.size;
+			}
+			return it->second;
+		}
+		_mapped_paths.erase(it); // file changed: old mapping stays with its users
+	}
+	void *addr = ::mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd); // mapping stays valid
+	if (addr == MAP_FAILED) {
+		return nullptr;
+	}
+	const unsigned char *data = (const unsigned char *)addr;
+	_mapped_paths[key] = data;
+	_mappings[data] = _Mapping{ key, size_t(st.st_size), 0, 1, st.st_dev, st.st_ino, st.st_mtime };
+	if (size) {
+		*size = st.st_size;
+	}
+	return data;
+#else
+	return nullptr;
+#endif
+}
+
+const unsigned char *_gd_fmmap(PYFILE *f, size_t *size) {
+	if (f && f->fa && f->flags == FileAccess::READ) {
+		return _gd_mmap(f->fa->get_path().utf8().get_data(), size);
+	}
+	return nullptr;
+}
+
+void _gd_munmap(const unsigned char *data) {
+#ifdef PYFILE_MMAP_ENABLED
+	if (data) {
+		std::lock_guard<std::mutex> lock(_mappings_mutex);
+		auto it = _mappings.find(data);
+		if (it != _mappings.end() && --it->second.refs == 0) {
+			::munmap((void *)(data - it->second.skip), it->second.size + it->second.skip);
+			auto path = _mapped_paths.find(it->second.path);
+			if (path != _mapped_paths.end() && path->second == data) { // not replaced by a newer mapping
+				_mapped_paths.erase(path);
+			}
+			_mappings.erase(it);
+		}
+	}
+#endif
+}
+
 PYFILE *_gd_stderr() {
 	return &gd_stderr;
 }
@@ -25,6 +25,21 @@ extern "C" {
 
 typedef struct PYFILE PYFILE;
 
+/* Read window of the PYFILE buffer (every PYFILE starts with it), so getc
+   and ungetc of buffered bytes are done without a call. */
+typedef struct _gd_filebuf {
+	unsigned char *rpos; /* next buffered byte */
+	unsigned char *rend; /* end of buffered bytes */
+	unsigned char *rbase; /* start of the buffer (pushback limit) */
+} _gd_filebuf;
+
+#define _GD_FILEBUF(F) ((_gd_filebuf *)(F))
+#define _gd_getc_inline(F) \
+	(_GD_FILEBUF(F)->rpos < _GD_FILEBUF(F)->rend ? (int)*_GD_FILEBUF(F)->rpos++ : _gd_getc(F))
+#define _gd_ungetc_inline(C, F) \
+	((C) != EOF && _GD_FILEBUF(F)->rpos > _GD_FILEBUF(F)->rbase && _GD_FILEBUF(F)->rpos[-1] == (unsigned char)(C) \
+		? (--_GD_FILEBUF(F)->rpos, (int)(unsigned char)(C)) : _gd_ungetc(C, F))
+
 int _gd_chdir(const char *dir);
 int _gd_mkdir(const char *dir);
 char *_gd_getcwd(char *buf, int size);
@@ -44,6 +59,12 @@ PYFILE *_gd_fdopen(const int fd, const char *mode);
 int _gd_fstat(int fd, struct stat *buf);
 int _gd_fstatf(PYFILE *f, struct stat *buf);
 int _gd_stat(const char *path, struct stat *buf);
+/* Cached existence and st_mode of a path for import probing, other fields
+   are zero (invalidated by changes made through this layer and posixmodule;
+   files changed elsewhere need explicit invalidate). */
+int _gd_probe(const char *path, struct stat *buf);
+void _gd_stat_cache_info(unsigned long long *probes, unsigned long long *hits, size_t *entries);
+void _gd_stat_cache_invalidate();
 int _gd_fclose(PYFILE *f);
 int _gd_fseek(PYFILE *f, off_t offset, int whence);
 off_t _gd_ftell(PYFILE *f);
@@ -57,6 +78,7 @@ int _gd_fputs(const char* buf, PYFILE *f);
 int _gd_getc(PYFILE *f);
 int _gd_putc(int ch, PYFILE *f);
 int _gd_ungetc(int c, PYFILE *f);
+int _gd_setvbuf(PYFILE *f, int mode, size_t size);
 PYFILE *_gd_tmpfile();
 int _gd_fflush(PYFILE *f);
 int _gd_fileno(PYFILE *f);
@@ -64,6 +86,12 @@ int _gd_feof(PYFILE *f);
 int _gd_ferror(PYFILE *f);
 void _gd_clearerr(PYFILE *f);
 ssize_t _gd_ffilesize(PYFILE *f);
+/* Read-only mapping of a whole file (NULL if it can not be mapped, eg. it
+   is packed in PCK), has to be released with _gd_munmap. */
+const unsigned char *_gd_mmap(const char *path, size_t *size);
+const unsigned char *_gd_fmmap(PYFILE *f, size_t *size);
+void _gd_munmap(const unsigned char *data);
+
 PYFILE *_gd_stderr();
 PYFILE *_gd_stdin();
 PYFILE *_gd_stdout();
@@ -85,6 +113,7 @@ PYFILE *_gd_stdout();
 #define pystdin     _gd_stdin()
 #define pystdout    _gd_stdout()
 #define pystat      _gd_stat
+#define pyprobe     _gd_probe
 #define pyfstat     _gd_fstat
 #define pyfstatf    _gd_fstatf
 #define pyfopen     _gd_fopen
@@ -100,8 +129,9 @@ PYFILE *_gd_stdout();
 #define pyfputs     _gd_fputs
 #define pyputc      _gd_putc
 #define pyfputc     _gd_putc
-#define pygetc      _gd_getc
-#define pyungetc    _gd_ungetc
+#define pygetc      _gd_getc_inline
+#define pyungetc    _gd_ungetc_inline
+#define pysetvbuf   _gd_setvbuf
 #define pyfprintf   _gd_fprintf
 #define pyvfprintf  _gd_vfprintf
 #define pyrewind    _gd_rewind
@@ -111,6 +141,9 @@ PYFILE *_gd_stdout();
 #define pyferror    _gd_ferror
 #define pyclearerr  _gd_clearerr
 #define pyffilesize _gd_ffilesize
+#define pymmap      _gd_mmap
+#define pyfmmap     _gd_fmmap
+#define pymunmap    _gd_munmap
 
 #if 0
 
@@ -137,6 +170,7 @@ typedef FILE PYFILE;
 #define pypopen    popen
 #define pyfclose   fclose
 #define pystat     stat
+#define pyprobe    stat
 #define pyfstat(F,B) fstat(fileno(F), B)
 #define pyfseek    fseek
 #define pyftell    ftell
@@ -69,6 +69,13 @@ PyAPI_FUNC(PyObject *) PyEval_EvalFrameEx(struct _frame *f, int exc);
 PyAPI_DATA(volatile int) _Py_Ticker;
 PyAPI_DATA(int) _Py_CheckInterval;
 
+#ifdef GD_PYTHON
+/* Godot: called by the eval loop every _Py_CheckInterval instructions;
+   returning -1 with an exception set aborts the running frame */
+typedef int (*Py_periodic_hook)(void);
+PyAPI_DATA(Py_periodic_hook) _Py_PeriodicHook;
+#endif
+
 /* Interface for threads.
 
    A module that plans to do a blocking system call (or something else
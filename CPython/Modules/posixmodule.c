@@ -2641,7 +2641,11 @@ error:
     Py_INCREF(Py_None);
     return Py_None;
 #else
-    return posix_2str(args, "etet:rename", rename);
+    PyObject *result = posix_2str(args, "etet:rename", rename);
+#ifdef GD_PYTHON
+    _gd_stat_cache_invalidate();
+#endif
+    return result;
 #endif
 }
 
@@ -2656,7 +2660,11 @@ posix_rmdir(PyObject *self, PyObject *args)
 #ifdef MS_WINDOWS
     return win32_1str(args, "rmdir", "s:rmdir", RemoveDirectoryA, "U:rmdir", RemoveDirectoryW);
 #else
-    return posix_1str(args, "et:rmdir", rmdir);
+    PyObject *result = posix_1str(args, "et:rmdir", rmdir);
+#ifdef GD_PYTHON
+    _gd_stat_cache_invalidate();
+#endif
+    return result;
 #endif
 }
 
@@ -2727,7 +2735,11 @@ posix_unlink(PyObject *self, PyObject *args)
 #ifdef MS_WINDOWS
     return win32_1str(args, "remove", "s:remove", DeleteFileA, "U:remove", DeleteFileW);
 #else
-    return posix_1str(args, "et:remove", unlink);
+    PyObject *result = posix_1str(args, "et:remove", unlink);
+#ifdef GD_PYTHON
+    _gd_stat_cache_invalidate();
+#endif
+    return result;
 #endif
 }
 
@@ -6493,6 +6505,10 @@ posix_open(PyObject *self, PyObject *args)
     Py_BEGIN_ALLOW_THREADS
     fd = open(file, flag, mode);
     Py_END_ALLOW_THREADS
+#ifdef GD_PYTHON
+    if (flag & O_CREAT)
+        _gd_stat_cache_invalidate();
+#endif
     if (fd < 0)
         return posix_error_with_allocated_filename(file);
     PyMem_Free(file);
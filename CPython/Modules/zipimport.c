@@ -38,6 +38,8 @@ struct _zipimporter {
     PyObject *archive;  /* pathname of the Zip archive */
     PyObject *prefix;   /* file prefix: "a/sub/directory/" */
     PyObject *files;    /* dict with file info {path: toc_entry} */
+    const unsigned char *map;   /* read-only mapping of the archive or NULL */
+    size_t map_size;
 };
 
 static PyObject *ZipImportError;
@@ -45,7 +47,7 @@ static PyObject *zip_directory_cache = NULL;
 
 /* forward decls */
 static PyObject *read_directory(char *archive);
-static PyObject *get_data(char *archive, PyObject *toc_entry);
+static PyObject *get_data(ZipImporter *self, PyObject *toc_entry);
 static PyObject *get_module_code(ZipImporter *self, char *fullname,
                                  int *p_ispackage, char **p_modpath);
 
@@ -158,6 +160,9 @@ zipimporter_init(ZipImporter *self, PyObject *args, PyObject *kwds)
     if (self->archive == NULL)
         return -1;
 
+    pymunmap(self->map);
+    self->map = pymmap(buf, &self->map_size);
+
     self->prefix = PyString_FromString(prefix);
     if (self->prefix == NULL)
         return -1;
@@ -181,6 +186,7 @@ zipimporter_dealloc(ZipImporter *self)
     Py_XDECREF(self->archive);
     Py_XDECREF(self->prefix);
     Py_XDECREF(self->files);
+    pymunmap(self->map);
     Py_TYPE(self)->tp_free((PyObject *)self);
 }
 
@@ -453,7 +459,7 @@ zipimporter_get_data(PyObject *obj, PyObject *args)
         PyErr_SetFromErrnoWithFilename(PyExc_IOError, path);
         return NULL;
     }
-    return get_data(PyString_AsString(self->archive), toc_entry);
+    return get_data(self, toc_entry);
 }
 
 static PyObject *
@@ -503,7 +509,7 @@ zipimporter_get_source(PyObject *obj, PyObject *args)
 
     toc_entry = PyDict_GetItemString(self->files, path);
     if (toc_entry != NULL)
-        return get_data(PyString_AsString(self->archive), toc_entry);
+        return get_data(self, toc_entry);
 
     /* we have the module, but no source */
     Py_INCREF(Py_None);
@@ -828,10 +834,48 @@ get_decompress_func(void)
     return decompress;
 }
 
-/* Given a path to a Zip file and a toc_entry, return the (uncompressed)
+/* Locate the data of a toc_entry in the archive mapping. Returns 0 and
+   sets the data pointer, or -1 with an exception. */
+static int
+get_mapped_data(ZipImporter *self, PyObject *toc_entry,
+                const unsigned char **p_data, long *p_compress, long *p_size)
+{
+    char *datapath;
+    long compress, data_size, file_size, file_offset;
+    long time, date, crc;
+    const unsigned char *header;
+
+    if (!PyArg_ParseTuple(toc_entry, "slllllll", &datapath, &compress,
+                          &data_size, &file_size, &file_offset, &time,
+                          &date, &crc)) {
+        return -1;
+    }
+    if (file_offset < 0 || (size_t)file_offset + 30 > self->map_size ||
+        get_long((unsigned char *)self->map + file_offset) != 0x04034B50) {
+        /* Bad: Local File Header */
+        PyErr_Format(ZipImportError,
+                     "bad local file header in %s",
+                     PyString_AsString(self->archive));
+        return -1;
+    }
+    header = self->map + file_offset;
+    file_offset += 30 + (header[26] | header[27] << 8) +
+                   (header[28] | header[29] << 8);  /* local header size */
+    if (data_size < 0 || (size_t)file_offset + data_size > self->map_size) {
+        PyErr_SetString(PyExc_IOError,
+                        "zipimport: can't read data");
+        return -1;
+    }
+    *p_data = self->map + file_offset;
+    *p_compress = compress;
+    *p_size = data_size;
+    return 0;
+}
+
+/* Given a zipimporter and a toc_entry, return the (uncompressed)
    data as a new reference. */
 static PyObject *
-get_data(char *archive, PyObject *toc_entry)
+get_data(ZipImporter *self, PyObject *toc_entry)
 {
     PyObject *raw_data, *data = NULL, *decompress;
     char *buf;
@@ -842,6 +886,23 @@ get_data(char *archive, PyObject *toc_entry)
     char *datapath;
     long compress, data_size, file_size, file_offset;
     long time, date, crc;
+    char *archive = PyString_AsString(self->archive);
+
+    if (archive == NULL)
+        return NULL;
+
+    if (self->map != NULL) {
+        const unsigned char *mapped;
+        if (get_mapped_data(self, toc_entry, &mapped, &compress, &data_size) != 0)
+            return NULL;
+        if (compress == 0)
+            return PyString_FromStringAndSize((const char *)mapped, data_size);
+        /* inflate straight from the mapping */
+        raw_data = PyBuffer_FromMemory((void *)mapped, data_size);
+        if (raw_data == NULL)
+            return NULL;
+        goto inflate;
+    }
 
     if (!PyArg_ParseTuple(toc_entry, "slllllll", &datapath, &compress,
                           &data_size, &file_size, &file_offset, &time,
@@ -900,6 +961,7 @@ get_data(char *archive, PyObject *toc_entry)
     if (compress == 0)  /* data is not compressed */
         return raw_data;
 
+inflate:
     /* Decompress with zlib */
     decompress = get_decompress_func();
     if (decompress == NULL) {
@@ -1115,11 +1177,9 @@ read_compiled_module(char *cpathname, PYFILE *fp)
    to .py if available and we don't want to mask other errors).
    Returns a new reference. */
 static PyObject *
-unmarshal_code(char *pathname, PyObject *data, time_t mtime)
+unmarshal_code(char *pathname, const char *buf, Py_ssize_t size, time_t mtime)
 {
     PyObject *code;
-    char *buf = PyString_AsString(data);
-    Py_ssize_t size = PyString_Size(data);
 
     if (size <= 9) {
         PyErr_SetString(ZipImportError,
@@ -1144,7 +1204,7 @@ unmarshal_code(char *pathname, PyObject *data, time_t mtime)
         return Py_None;  /* signal caller to try alternative */
     }
 
-    code = PyMarshal_ReadObjectFromString(buf + 8, size - 8);
+    code = PyMarshal_ReadObjectFromString((char *)buf + 8, size - 8);
     if (code == NULL)
         return NULL;
     if (!PyCode_Check(code)) {
@@ -1275,14 +1335,25 @@ get_code_from_data(ZipImporter *self, int ispackage, int isbytecode,
     if (archive == NULL)
         return NULL;
 
-    data = get_data(archive, toc_entry);
+    modpath = PyString_AsString(PyTuple_GetItem(toc_entry, 0));
+
+    if (isbytecode && self->map != NULL) {
+        /* stored bytecode is unmarshalled straight from the mapping */
+        const unsigned char *mapped;
+        long compress, data_size;
+        if (get_mapped_data(self, toc_entry, &mapped, &compress, &data_size) != 0)
+            return NULL;
+        if (compress == 0)
+            return unmarshal_code(modpath, (const char *)mapped, data_size, mtime);
+    }
+
+    data = get_data(self, toc_entry);
     if (data == NULL)
         return NULL;
 
-    modpath = PyString_AsString(PyTuple_GetItem(toc_entry, 0));
-
     if (isbytecode) {
-        code = unmarshal_code(modpath, data, mtime);
+        code = unmarshal_code(modpath, PyString_AS_STRING(data),
+                              PyString_GET_SIZE(data), mtime);
     }
     else {
         cpathname = make_pycache_pathname(modpath, buf, (size_t)MAXPATHLEN + 1);
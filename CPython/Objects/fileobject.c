@@ -543,6 +543,8 @@ PyFile_SetBufSize(PyObject *f, int bufsize)
 # else /* !HAVE_SETVBUF */
         setbuf(file->f_fp, file->f_setbuf);
 # endif /* !HAVE_SETVBUF */
+#elif defined(GD_PYTHON)
+        pysetvbuf(file->f_fp, type, bufsize);
 #endif
     }
 }
@@ -1205,13 +1207,18 @@ trailing null byte.  #define DONT_USE_FGETS_IN_GETLINE to disable this code.
 #define USE_FGETS_IN_GETLINE
 #endif
 
+/* Godot files: pyfgets copies whole lines from the PYFILE buffer */
+#if !defined(USE_FGETS_IN_GETLINE) && defined(GD_PYTHON)
+#define USE_FGETS_IN_GETLINE
+#endif
+
 #if defined(DONT_USE_FGETS_IN_GETLINE) && defined(USE_FGETS_IN_GETLINE)
 #undef USE_FGETS_IN_GETLINE
 #endif
 
 #ifdef USE_FGETS_IN_GETLINE
 static PyObject*
-getline_via_fgets(PyFileObject *f, FILE *fp)
+getline_via_fgets(PyFileObject *f, PYFILE *fp)
 {
 /* INITBUFSIZE is the maximum line length that lets us get away with the fast
  * no-realloc, one-fgets()-call path.  Boosting it isn't free, because we have
@@ -1249,11 +1256,11 @@ getline_via_fgets(PyFileObject *f, FILE *fp)
         nfree = pvend - pvfree;
         memset(pvfree, '\n', nfree);
         assert(nfree < INT_MAX); /* Should be atmost MAXBUFSIZE */
-        p = fgets(pvfree, (int)nfree, fp);
+        p = pyfgets(pvfree, (int)nfree, fp);
         FILE_END_ALLOW_THREADS(f)
 
         if (p == NULL) {
-            clearerr(fp);
+            pyclearerr(fp);
             if (PyErr_CheckSignals())
                 return NULL;
             v = PyString_FromStringAndSize(buf, pvfree - buf);
@@ -1324,11 +1331,11 @@ getline_via_fgets(PyFileObject *f, FILE *fp)
         nfree = pvend - pvfree;
         memset(pvfree, '\n', nfree);
         assert(nfree < INT_MAX);
-        p = fgets(pvfree, (int)nfree, fp);
+        p = pyfgets(pvfree, (int)nfree, fp);
         FILE_END_ALLOW_THREADS(f)
 
         if (p == NULL) {
-            clearerr(fp);
+            pyclearerr(fp);
             if (PyErr_CheckSignals()) {
                 Py_DECREF(v);
                 return NULL;
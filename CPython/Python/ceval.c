@@ -660,6 +660,9 @@ static int _Py_TracingPossible = 0;
    per thread, now just a pair o' globals */
 int _Py_CheckInterval = 100;
 volatile int _Py_Ticker = 0; /* so that we hit a "tick" first thing */
+#ifdef GD_PYTHON
+Py_periodic_hook _Py_PeriodicHook = NULL;
+#endif
 
 PyObject *
 PyEval_EvalCode(PyCodeObject *co, PyObject *globals, PyObject *locals)
@@ -1007,6 +1010,12 @@ PyEval_EvalFrameEx(PyFrameObject *f, int throwflag)
                        a thread switch */
                     _Py_Ticker = 0;
             }
+#ifdef GD_PYTHON
+            if (_Py_PeriodicHook && _Py_PeriodicHook() < 0) {
+                why = WHY_EXCEPTION;
+                goto on_error;
+            }
+#endif
 #ifdef WITH_THREAD
             if (interpreter_lock) {
                 /* Give another thread a chance */
@@ -1180,7 +1180,7 @@ _is_cached_package(const char *path) {
     *buf = Py_OptimizeFlag ? 'o' : 'c';
     if (Py_VerboseFlag)
         PySys_WriteStderr("# checking %s\n", buffer);
-    return (pystat(buffer, NULL) == 0);
+    return (pyprobe(buffer, NULL) == 0);
 }
 
 /* Forward */
@@ -1549,7 +1549,7 @@ find_module(char *fullname, char *subname, PyObject *path, char *buf,
         /* no hook was found, use builtin import */
 
 #ifdef HAVE_STAT
-        if (pystat(buf, &statbuf) == 0 &&      /* it exists */
+        if (pyprobe(buf, &statbuf) == 0 &&     /* it exists */
             S_ISREG(statbuf.st_mode)) {         /* it's a file */
                 Py_XDECREF(copy);
                 continue;
@@ -1568,7 +1568,7 @@ find_module(char *fullname, char *subname, PyObject *path, char *buf,
         /* Check for package import (but holds a directory name,
            and there's an __init__ module in that directory */
 #ifdef HAVE_STAT
-        if (pystat(buf, &statbuf) == 0 &&       /* it exists */
+        if (pyprobe(buf, &statbuf) == 0 &&      /* it exists */
             S_ISDIR(statbuf.st_mode) &&         /* it's a directory */
             case_ok(buf, len, namelen, name)) { /* case matches */
             if (find_init_module(buf)) {        /* and has __init__.py */
@@ -1921,7 +1921,7 @@ find_init_module(char *buf)
     buf[i++] = SEP;
     pname = buf + i;
     strcpy(pname, "__init__.py");
-    if (pystat(buf, &statbuf) == 0) {
+    if (pyprobe(buf, &statbuf) == 0) {
         if (case_ok(buf,
                     save_len + 9,               /* len("/__init__") */
                 8,                              /* len("__init__") */
@@ -1932,7 +1932,7 @@ find_init_module(char *buf)
     }
     i += strlen(pname);
     strcpy(buf+i, Py_OptimizeFlag ? "o" : "c");
-    if (pystat(buf, &statbuf) == 0) {
+    if (pyprobe(buf, &statbuf) == 0) {
         if (case_ok(buf,
                     save_len + 9,               /* len("/__init__") */
                 8,                              /* len("__init__") */
@@ -3398,7 +3398,7 @@ NullImporter_init(NullImporter *self, PyObject *args, PyObject *kwds)
                             "virtual directory");
             return -1;
         }
-        int rv = pystat(path, &statbuf);
+        int rv = pyprobe(path, &statbuf);
         if (rv == 0) {
             /* it exists */
             if (S_ISDIR(statbuf.st_mode)) {
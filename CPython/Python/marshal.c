@@ -1109,7 +1109,7 @@ PyMarshal_ReadLongFromFile(PYFILE *fp)
 static off_t
 getfilesize(PYFILE *fp)
 {
-#ifdef QT_CORE_LIB
+#if defined(QT_CORE_LIB) || defined(GD_PYTHON)
     return pyffilesize(fp);
 #else
     struct stat st;
@@ -1132,6 +1132,23 @@ PyMarshal_ReadLastObjectFromFile(PYFILE *fp)
 {
 /* REASONABLE_FILE_LIMIT is by defn something big enough for Tkinter.pyc. */
 #define REASONABLE_FILE_LIMIT (1L << 18)
+#ifdef GD_PYTHON
+    /* read-only files on a real filesystem are unmarshalled from a mapping */
+    {
+        size_t mapsize;
+        const unsigned char *map = pyfmmap(fp, &mapsize);
+        if (map != NULL) {
+            PyObject *v = NULL;
+            off_t pos = pyftell(fp);
+            if (pos >= 0 && (size_t)pos <= mapsize)
+                v = PyMarshal_ReadObjectFromString((char *)map + pos, mapsize - pos);
+            else
+                PyErr_SetString(PyExc_EOFError, "EOF read where object expected");
+            pymunmap(map);
+            return v;
+        }
+    }
+#endif
 #ifdef HAVE_FSTAT
     off_t filesize;
     filesize = getfilesize(fp);
@@ -9,6 +9,7 @@
 #include "servers/visual_server.h"
 
 #include "pylib/godot/py_godot.h"
+#include "pylib/godot/py_casters.h"
 
 #include <Python.h>
 #include <osdefs.h>
@@ -24,37 +25,98 @@ PyObject *call_function(PyObject *p_module, String p_func_name, PyObject *p_args
 bool add_builtin_symbol(String p_key, Variant p_val);
 bool add_builtin_symbols(Dictionary p_vals);
 
-constexpr const char *__init_func = "gd_init";
-constexpr const char *__tick_func = "gd_tick";
-constexpr const char *__draw_func = "gd_draw";
-constexpr const char *__event_func = "gd_event";
-constexpr const char *__term_func = "gd_term";
-
 CPythonEngine *CPythonEngine::instance = nullptr;
 
-CPythonEngine *CPythonEngine::get_singleton() {
+void CPythonEngine::_initialize() {
 	static char exec_name[] = "pygodot";
 	static char pythoncaseok[] = "PYTHONCASEOK";
 	static char pythonpycacheprefix[] = "PYTHONPYCACHEPREFIX=res://pycache/";
 	static char vhome[] = "VHOME=user://";
 
-	if (!Py_IsInitialized()) {
-		Py_SetProgramName(exec_name);
+	Py_SetProgramName(exec_name);
+
+	Py_NoSiteFlag = 1;
+
+	__putenv(pythonpycacheprefix);
+	__putenv(pythoncaseok);
+	__putenv(vhome);
+
+	uint64_t start = OS::get_singleton()->get_ticks_usec();
+	Py_InitializeEx(0);
+	init_stats["initialize_usec"] = OS::get_singleton()->get_ticks_usec() - start;
 
-		Py_NoSiteFlag = 1;
+	start = OS::get_singleton()->get_ticks_usec();
+	char* n_argv[] = { exec_name };
+	PySys_SetArgv(1, n_argv);
+	init_stats["set_argv_usec"] = OS::get_singleton()->get_ticks_usec() - start;
 
-		__putenv(pythonpycacheprefix);
-		__putenv(pythoncaseok);
-		__putenv(vhome);
+	print_line(vformat("Python interpreter version: %s on %s", Py_GetVersion(), Py_GetPlatform()));
+	print_verbose(vformat("Python standard library path: %s", Py_GetPath()));
+	print_verbose(vformat("Python settings: NoSiteFlag=%d, VerboseFlag=%d, DebugFlag=%d, OptimizeFlag=%d", Py_NoSiteFlag, Py_VerboseFlag, Py_DebugFlag, Py_OptimizeFlag));
+	print_verbose(vformat("Python initialized in %d usec (argv: %d usec)", init_stats["initialize_usec"], init_stats["set_argv_usec"]));
+}
+
+// Warm-up imports only: interpreter is initialized by the main thread, which
+// ceval and threading record as the main thread of the interpreter
+void CPythonEngine::_background_init(const Vector<String> &p_imports) {
+	const PyGILState_STATE gil = PyGILState_Ensure();
+
+	const uint64_t start = OS::get_singleton()->get_ticks_usec();
+	for (int i = 0; i < p_imports.size(); i++) {
+		const uint64_t import_start = OS::get_singleton()->get_ticks_usec();
+		if (PyObject *module = PyImport_ImportModule(p_imports[i].utf8().get_data())) {
+			Py_DECREF(module);
+		} else {
+			WARN_PRINT("Failed to import python module " + p_imports[i]);
+			PyErr_Print();
+		}
+		_init_timings.push_back(std::make_pair("import:" + p_imports[i], OS::get_singleton()->get_ticks_usec() - import_start));
+	}
+	_init_timings.push_back(std::make_pair(String("warmup_usec"), OS::get_singleton()->get_ticks_usec() - start));
+
+	PyGILState_Release(gil);
+}
+
+void CPythonEngine::_wait_background_init() {
+	const uint64_t start = OS::get_singleton()->get_ticks_usec();
+	_init_thread.join();
+	PyEval_RestoreThread((PyThreadState *)_main_thread_state); // saved in start_background_init
+	_main_thread_state = nullptr;
+	for (const std::pair<String, uint64_t> &timing : _init_timings) {
+		init_stats[timing.first] = timing.second;
+	}
+	_init_timings.clear();
+	init_stats["wait_usec"] = OS::get_singleton()->get_ticks_usec() - start;
+	print_verbose(vformat("Python background initialization: %s", init_stats));
+}
 
-		Py_InitializeEx(0);
+void CPythonEngine::start_background_init(const Vector<String> &p_imports) {
+	ERR_FAIL_COND_MSG(Py_IsInitialized() || _init_thread.joinable(), "Python interpreter is already initialized.");
+	_initialize();
+	if (p_imports.empty()) {
+		return;
+	}
+	// threading keeps the thread importing it as its main thread
+	if (PyObject *threading = PyImport_ImportModule("threading")) {
+		Py_DECREF(threading);
+	} else {
+		PyErr_Print();
+	}
+	PyEval_InitThreads();
+	_main_thread_state = PyEval_SaveThread(); // restored in _wait_background_init
+	_init_thread = std::thread(&CPythonEngine::_background_init, this, p_imports);
+}
 
-		char* n_argv[] = { exec_name };
-		PySys_SetArgv(1, n_argv);
+void CPythonEngine::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("get_init_stats"), &CPythonEngine::get_init_stats);
+}
 
-		print_line(vformat("Python interpreter version: %s on %s", Py_GetVersion(), Py_GetPlatform()));
-		print_verbose(vformat("Python standard library path: %s", Py_GetPath()));
-		print_verbose(vformat("Python settings: NoSiteFlag=%d, VerboseFlag=%d, DebugFlag=%d, OptimizeFlag=%d", Py_NoSiteFlag, Py_VerboseFlag, Py_DebugFlag, Py_OptimizeFlag));
+CPythonEngine *CPythonEngine::get_singleton() {
+	if (instance && instance->_init_thread.joinable()) {
+		instance->_wait_background_init(); // blocks only if not finished yet
+	}
+	if (instance && !Py_IsInitialized()) {
+		instance->_initialize();
 	}
 
 	return instance;
@@ -74,10 +136,101 @@ bool CPythonEngine::_add_path(const String &p_path, const String &p_object) {
 	return false;
 }
 
+void CPythonEngine::release_main_thread() {
+	if (!_main_thread_state) {
+		PyEval_InitThreads();
+		_main_thread_state = PyEval_SaveThread();
+		print_verbose("Python interpreter lock released by the main thread.");
+	}
+}
+
+void *CPythonEngine::_compile_code(const String &p_python_code) {
+	if (void **cached = code_cache.getptr(p_python_code)) {
+		return *cached;
+	}
+	const CharString code = p_python_code.utf8();
+	PyObject *co = Py_CompileString(code.get_data(), "<string>", Py_file_input);
+	if (co == nullptr) {
+		PyErr_Print();
+		return nullptr;
+	}
+	code_cache[p_python_code] = co;
+	return co;
+}
+
+void *CPythonEngine::_compile_file(const String &p_python_file) {
+	const uint64_t modified_time = FileAccess::get_modified_time(p_python_file);
+	if (CompiledFile *cached = file_cache.getptr(p_python_file)) {
+		if (cached->modified_time == modified_time) {
+			return cached->code;
+		}
+		Py_DECREF((PyObject *)cached->code);
+		file_cache.erase(p_python_file);
+	}
+	Error err;
+	Vector<uint8_t> source = FileAccess::get_file_as_array(p_python_file, &err);
+	if (err != OK) {
+		return nullptr;
+	}
+	source.push_back('\n');
+	source.push_back(0);
+	PyObject *co = Py_CompileString((const char *)source.ptr(), p_python_file.utf8().get_data(), Py_file_input);
+	if (co == nullptr) {
+		PyErr_Print();
+		return nullptr;
+	}
+	print_verbose(vformat("Compiled python file %s", p_python_file));
+	file_cache[p_python_file] = { co, modified_time };
+	return co;
+}
+
+// Execute code object in __main__ namespace, same as PyRun_Simple* functions
+Error CPythonEngine::_exec_code(void *p_code, const char *p_filename) {
+	PyObject *m = PyImport_AddModule("__main__");
+	ERR_FAIL_NULL_V(m, ERR_SCRIPT_FAILED);
+	PyObject *d = PyModule_GetDict(m);
+	bool set_file_name = false;
+	if (p_filename && PyDict_GetItemString(d, "__file__") == nullptr) {
+		PyObject *f = PyString_FromString(p_filename);
+		if (f == nullptr || PyDict_SetItemString(d, "__file__", f) < 0) {
+			Py_XDECREF(f);
+			PyErr_Print();
+			return ERR_SCRIPT_FAILED;
+		}
+		Py_DECREF(f);
+		set_file_name = true;
+	}
+	PyObject *res = PyEval_EvalCode((PyCodeObject *)p_code, d, d);
+	if (res == nullptr) {
+		PyErr_Print();
+	}
+	Py_XDECREF(res);
+	if (set_file_name && PyDict_DelItemString(d, "__file__")) {
+		PyErr_Clear();
+	}
+	return res ? OK : ERR_SCRIPT_FAILED;
+}
+
+void CPythonEngine::clear_code_cache() {
+	PyGodotGIL gil;
+	const String *key = nullptr;
+	while ((key = code_cache.next(key))) {
+		Py_DECREF((PyObject *)code_cache[*key]);
+	}
+	key = nullptr;
+	while ((key = file_cache.next(key))) {
+		Py_DECREF((PyObject *)file_cache[*key].code);
+	}
+	code_cache.clear();
+	file_cache.clear();
+	source_kinds.clear();
+}
+
 Error CPythonEngine::run_code(const String& p_python_code) {
+	PyGodotGIL gil;
 	if (!p_python_code.empty()) {
-		const char *code = p_python_code.utf8().get_data();
-		if (PyRun_SimpleString(code) == -1) {
+		void *code = _compile_code(p_python_code);
+		if (code == nullptr || _exec_code(code, nullptr) != OK) {
 			WARN_PRINT("Executing code with errors.");
 			return ERR_SCRIPT_FAILED;
 		}
@@ -88,7 +241,18 @@ Error CPythonEngine::run_code(const String& p_python_code) {
 }
 
 Error CPythonEngine::run_file(const String& p_python_file) {
+	PyGodotGIL gil;
 	if (!p_python_file.empty()) {
+		const String ext = p_python_file.get_extension();
+		if (ext != "pyc" && ext != "pyo") {
+			if (void *code = _compile_file(p_python_file)) {
+				_add_path(p_python_file.get_base_dir(), "path");
+				return _exec_code(code, p_python_file.utf8().get_data());
+			}
+			if (FileAccess::exists(p_python_file)) {
+				return ERR_SCRIPT_FAILED; // syntax error
+			}
+		}
 		const std::string file(p_python_file.utf8().get_data());
 		PYFILE *fp = pyfopen(file.c_str(), "r");
 		if (fp != nullptr) {
@@ -111,7 +275,22 @@ Error CPythonEngine::run_file(const String& p_python_file) {
 	}
 }
 
+// Dotted name of the module, eg. "scripts.control"
+static bool _is_module_name(const String &p_name) {
+	if (p_name.empty()) {
+		return false;
+	}
+	const Vector<String> parts = p_name.split(".");
+	for (int i = 0; i < parts.size(); i++) {
+		if (!parts[i].is_valid_identifier()) {
+			return false;
+		}
+	}
+	return true;
+}
+
 Error CPythonEngine::run_module(const String& p_python_module) {
+	PyGodotGIL gil;
 	const int set_argv0 = 1;
 	PyObject *runpy, *runmodule, *runargs, *result;
 	runpy = PyImport_ImportModule("runpy");
@@ -147,15 +326,27 @@ Error CPythonEngine::run_module(const String& p_python_module) {
 }
 
 Error CPythonEngine::run_python(const String& p_python, const Dictionary &p_context) {
+	PyGodotGIL gil;
 	Array search_paths = p_context[KEY_SEARCH_PATHS];
 	for (const String p : search_paths) {
 		_add_path(p, "path");
 	}
 	Dictionary builtins = p_context[KEY_BUILTINS];
 	add_builtin_symbols(builtins);
-	if (FileAccess::exists(p_python)) {
+	SourceKind kind;
+	if (const SourceKind *known = source_kinds.getptr(p_python)) {
+		kind = *known;
+	} else if (FileAccess::exists(p_python)) {
+		kind = source_kinds[p_python] = SOURCE_FILE;
+	} else if (_is_module_name(p_python)) {
+		kind = SOURCE_MODULE; // remembered after successful run
+	} else {
+		kind = source_kinds[p_python] = SOURCE_CODE; // runpy is not even tried
+	}
+	if (kind == SOURCE_FILE) {
 		return run_file(p_python);
-	} else if (run_module(p_python) == OK) {
+	} else if (kind == SOURCE_MODULE && run_module(p_python) == OK) {
+		source_kinds[p_python] = SOURCE_MODULE;
 		return OK;
 	} else {
 		return run_code(p_python);
@@ -164,9 +355,20 @@ Error CPythonEngine::run_python(const String& p_python, const Dictionary &p_cont
 
 CPythonEngine::CPythonEngine() {
 	instance = this;
+	_main_thread_state = nullptr;
 }
 
 CPythonEngine::~CPythonEngine() {
+	if (_init_thread.joinable()) {
+		_wait_background_init();
+	}
+	if (_main_thread_state) {
+		PyEval_RestoreThread((PyThreadState *)_main_thread_state);
+		_main_thread_state = nullptr;
+	}
+	if (Py_IsInitialized()) {
+		clear_code_cache();
+	}
 	Py_Finalize();
 	instance = nullptr;
 }
@@ -239,7 +441,7 @@ void CPythonInstance::_input(const Ref<InputEvent> &p_event) {
 	ERR_FAIL_COND(!is_visible_in_tree());
 
 	if (_running) {
-		if (_py.process_events(p_event, __event_func)) {
+		if (batch_events || _py.is_threaded() ? _py.queue_events(p_event, coalesce_motion) : _py.process_events(p_event)) {
 			return;
 		}
 	}
@@ -259,14 +461,21 @@ void CPythonInstance::_notification(int p_what) {
 			set_process(false);
 			set_process_input(false);
 			if (_running) {
-				_py.pycall(__term_func);
+				_py.stop_thread();
+				_py.pycall(PyGodotInstance::CALLBACK_TERM);
 				_running = false;
 				_py.destroy_pygodot();
 			}
 		} break;
 		case NOTIFICATION_DRAW: {
-			if (_running) {
-				_py.pycall(__draw_func); // call draw function
+			if (_running && _py.is_threaded()) {
+				_py.draw_thread(); // replay commands recorded by the worker
+			} else if (_running && retained_draw) {
+				_py.draw_retained(); // redraw layers changed since the last frame
+			} else if (_running && batch_draw) {
+				_py.draw_batched(); // record draw function and replay with merged draw calls
+			} else if (_running) {
+				_py.pycall(PyGodotInstance::CALLBACK_DRAW); // call draw function
 			} else {
 				// not active indicator
 				draw_rect(Rect2(Point2(), view_size), white, false);
@@ -288,9 +497,19 @@ void CPythonInstance::_notification(int p_what) {
 			}
 		} break;
 		case NOTIFICATION_PROCESS: {
+			if (_running && _py.is_threaded()) {
+				if (!_pausing && _py.sync_thread(get_process_delta_time())) { // swap in the last recorded frame
+					update();
+				}
+				break;
+			}
+			if (_running && batch_events) {
+				_py.flush_events(); // deliver queued events before tick
+			}
 			if (_running && !_pausing) {
 				const real_t delta = get_process_delta_time();
-				if (_py.pycall(__tick_func, delta)) { // call tick function
+				_py.run_coroutines(); // resume coroutines due in this frame
+				if (_py.pycall(PyGodotInstance::CALLBACK_TICK, delta)) { // call tick function
 					update();
 				}
 			}
@@ -309,6 +528,19 @@ void CPythonInstance::_notification(int p_what) {
 	}
 }
 
+// Connected (one shot) to signals awaited by coroutines, last arguments are
+// instance id of the emitter and signal name
+Variant CPythonInstance::_resume_coroutine(const Variant **p_args, int p_argcount, Variant::CallError &r_error) {
+	if (p_argcount < 2) {
+		r_error.error = Variant::CallError::CALL_ERROR_TOO_FEW_ARGUMENTS;
+		r_error.argument = 2;
+		return Variant();
+	}
+	r_error.error = Variant::CallError::CALL_OK;
+	_py.resume_coroutines(*p_args[p_argcount - 2], *p_args[p_argcount - 1]);
+	return Variant();
+}
+
 void CPythonInstance::_set_python_data_hint(int p_hint) {
 	python_data_hint = p_hint;
 	_change_notify();
@@ -360,6 +592,70 @@ String CPythonInstance::get_gd_build_func() const {
 	return python_gd_build_func;
 }
 
+void CPythonInstance::set_batch_events(bool p_batch) {
+	if (batch_events && !p_batch && _running) {
+		_py.flush_events();
+	}
+	batch_events = p_batch;
+}
+
+bool CPythonInstance::is_batch_events() const {
+	return batch_events;
+}
+
+void CPythonInstance::set_coalesce_motion(bool p_coalesce) {
+	coalesce_motion = p_coalesce;
+}
+
+bool CPythonInstance::is_coalesce_motion() const {
+	return coalesce_motion;
+}
+
+void CPythonInstance::set_batch_draw(bool p_batch) {
+	batch_draw = p_batch;
+}
+
+bool CPythonInstance::is_batch_draw() const {
+	return batch_draw;
+}
+
+void CPythonInstance::set_retained_draw(bool p_retained) {
+	retained_draw = p_retained;
+}
+
+bool CPythonInstance::is_retained_draw() const {
+	return retained_draw;
+}
+
+void CPythonInstance::set_threaded(bool p_threaded) {
+	ERR_FAIL_COND_MSG(_running, "Execution mode cannot be changed while running.");
+	threaded = p_threaded;
+}
+
+bool CPythonInstance::is_threaded() const {
+	return threaded;
+}
+
+void CPythonInstance::set_thread_latency(int p_frames) {
+	thread_latency = CLAMP(p_frames, 0, 1);
+}
+
+int CPythonInstance::get_thread_latency() const {
+	return thread_latency;
+}
+
+void CPythonInstance::set_frame_budget_msec(int p_msec) {
+	_py.set_frame_budget(MAX(p_msec, 0) * 1000);
+}
+
+int CPythonInstance::get_frame_budget_msec() const {
+	return _py.get_frame_budget() / 1000;
+}
+
+Dictionary CPythonInstance::get_budget_stats() const {
+	return _py.get_budget_stats();
+}
+
 void CPythonInstance::set_debug_level(int p_level) {
 	Py_DebugFlag = p_level;
 }
@@ -391,24 +687,31 @@ bool CPythonInstance::run() {
 
 	ERR_FAIL_NULL_V(cpython, false);
 
-	if (!python_data.empty() && _last_python_data != python_data) {
-		Dictionary context;
-		context[CPythonEngine::KEY_SEARCH_PATHS] = python_search_paths;
-		context[CPythonEngine::KEY_BUILTINS] = python_builtins;
-		cpython->run_python(python_data, context);
-		_last_python_data = python_data;
-		_running = !py_has_error();
-	}
-	if (_running) {
-		if (!python_gd_build_func.empty()) {
-			_py.build_pygodot(get_instance_id(), python_gd_build_func);
+	{
+		PyGodotGIL gil;
+		if (!python_data.empty() && _last_python_data != python_data) {
+			Dictionary context;
+			context[CPythonEngine::KEY_SEARCH_PATHS] = python_search_paths;
+			context[CPythonEngine::KEY_BUILTINS] = python_builtins;
+			cpython->run_python(python_data, context);
+			_last_python_data = python_data;
+			_running = !py_has_error();
 		}
-		auto r = _py.pycall(__init_func); // call init functions
-		#ifdef DEBUG_ENABLED
-		if (!r.is_nil()) {
-			print_verbose(vformat("Return value from %s: %s", __init_func, r));
+		if (_running) {
+			if (!python_gd_build_func.empty()) {
+				_py.build_pygodot(get_instance_id(), python_gd_build_func);
+			}
+			auto r = _py.pycall(PyGodotInstance::CALLBACK_INIT); // call init functions
+			#ifdef DEBUG_ENABLED
+			if (!r.is_nil()) {
+				print_verbose(vformat("Return value from %s: %s", PyGodotInstance::get_callback_name(PyGodotInstance::CALLBACK_INIT), r));
+			}
+			#endif
 		}
-		#endif
+	}
+	if (_running && threaded && !_py.is_threaded()) {
+		// outside of the lock scope - main thread is giving up the interpreter lock
+		_py.start_thread(get_instance_id(), thread_latency);
 	}
 	return _running;
 }
@@ -426,6 +729,21 @@ void CPythonInstance::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("is_autorun"), &CPythonInstance::is_autorun);
 	ClassDB::bind_method(D_METHOD("set_gd_build_func", "func"), &CPythonInstance::set_gd_build_func);
 	ClassDB::bind_method(D_METHOD("get_gd_build_func"), &CPythonInstance::get_gd_build_func);
+	ClassDB::bind_method(D_METHOD("set_batch_events", "batch"), &CPythonInstance::set_batch_events);
+	ClassDB::bind_method(D_METHOD("is_batch_events"), &CPythonInstance::is_batch_events);
+	ClassDB::bind_method(D_METHOD("set_coalesce_motion", "coalesce"), &CPythonInstance::set_coalesce_motion);
+	ClassDB::bind_method(D_METHOD("is_coalesce_motion"), &CPythonInstance::is_coalesce_motion);
+	ClassDB::bind_method(D_METHOD("set_batch_draw", "batch"), &CPythonInstance::set_batch_draw);
+	ClassDB::bind_method(D_METHOD("is_batch_draw"), &CPythonInstance::is_batch_draw);
+	ClassDB::bind_method(D_METHOD("set_retained_draw", "retained"), &CPythonInstance::set_retained_draw);
+	ClassDB::bind_method(D_METHOD("is_retained_draw"), &CPythonInstance::is_retained_draw);
+	ClassDB::bind_method(D_METHOD("set_threaded", "threaded"), &CPythonInstance::set_threaded);
+	ClassDB::bind_method(D_METHOD("is_threaded"), &CPythonInstance::is_threaded);
+	ClassDB::bind_method(D_METHOD("set_thread_latency", "frames"), &CPythonInstance::set_thread_latency);
+	ClassDB::bind_method(D_METHOD("get_thread_latency"), &CPythonInstance::get_thread_latency);
+	ClassDB::bind_method(D_METHOD("set_frame_budget_msec", "msec"), &CPythonInstance::set_frame_budget_msec);
+	ClassDB::bind_method(D_METHOD("get_frame_budget_msec"), &CPythonInstance::get_frame_budget_msec);
+	ClassDB::bind_method(D_METHOD("get_budget_stats"), &CPythonInstance::get_budget_stats);
 	ClassDB::bind_method(D_METHOD("set_debug_level"), &CPythonInstance::set_debug_level);
 	ClassDB::bind_method(D_METHOD("get_debug_level"), &CPythonInstance::get_debug_level);
 	ClassDB::bind_method(D_METHOD("set_verbose_level"), &CPythonInstance::set_verbose_level);
@@ -438,6 +756,7 @@ void CPythonInstance::_bind_methods() {
 
 	ClassDB::bind_method(D_METHOD("run"), &CPythonInstance::run);
 	ClassDB::bind_method(D_METHOD("_input"), &CPythonInstance::_input);
+	ClassDB::bind_vararg_method(METHOD_FLAGS_DEFAULT, "_resume_coroutine", &CPythonInstance::_resume_coroutine, MethodInfo("_resume_coroutine"));
 
 	ADD_PROPERTY(PropertyInfo(Variant::VECTOR2, "view_size"), "set_view_size", "get_view_size");
 	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "autorun"), "set_autorun", "is_autorun");
@@ -446,6 +765,13 @@ void CPythonInstance::_bind_methods() {
 	ADD_PROPERTY(PropertyInfo(Variant::STRING, "python_data"), "set_python_data", "get_python_data");
 	ADD_PROPERTY(PropertyInfo(Variant::ARRAY, "python_search_paths"), "set_python_search_paths", "get_python_search_paths");
 	ADD_PROPERTY(PropertyInfo(Variant::DICTIONARY, "python_builtins"), "set_python_builtins", "get_python_builtins");
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "batch_events"), "set_batch_events", "is_batch_events");
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "coalesce_motion"), "set_coalesce_motion", "is_coalesce_motion");
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "batch_draw"), "set_batch_draw", "is_batch_draw");
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "retained_draw"), "set_retained_draw", "is_retained_draw");
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "threaded"), "set_threaded", "is_threaded");
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "thread_latency", PROPERTY_HINT_ENUM, "None,One Frame"), "set_thread_latency", "get_thread_latency");
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "frame_budget_msec", PROPERTY_HINT_RANGE, "0,1000,1"), "set_frame_budget_msec", "get_frame_budget_msec");
 	ADD_PROPERTY(PropertyInfo(Variant::INT, "debug_level"), "set_debug_level", "get_debug_level");
 	ADD_PROPERTY(PropertyInfo(Variant::INT, "verbose_level"), "set_verbose_level", "get_verbose_level");
 	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "optimize_flag"), "set_optimize_flag", "get_optimize_flag");
@@ -463,6 +789,12 @@ CPythonInstance::CPythonInstance() {
 	python_gd_build_func = "_gd_build";
 	python_autorun = false;
 	python_data_hint = 2; // Module Name
+	batch_events = false;
+	coalesce_motion = true;
+	batch_draw = false;
+	retained_draw = false;
+	threaded = false;
+	thread_latency = 1;
 
 #ifdef DEBUG_ENABLED
 	Py_DebugFlag = 1;
@@ -554,51 +886,66 @@ PyObject *call_function(PyObject *p_module, String p_func_name, PyObject *p_args
 	return ret;
 }
 
-bool add_builtin_symbol(String p_key, Variant p_val) {
-	if (p_key.empty()) {
+// p_gdgame is the imported gdgame module: values are converted as in gdgame
+// (Vector2, Color, ... are gdgame.core objects), the module registers these types
+static bool _set_builtin_symbol(PyObject *p_builtins, PyObject *p_gdgame, const String &p_key, const Variant &p_val) {
+	if (p_key.empty() || p_gdgame == nullptr) {
 		return false;
 	}
-	bool ret = true;
-	if (PyObject *name = PyString_FromString("__builtin__")) {
-		if (PyObject *builtin = PyImport_Import(name)) {
-			PyObject *builtin_dict = PyModule_GetDict(builtin);
-			switch (p_val.get_type()) {
-				case Variant::INT: {
-					int val = p_val;
-					PyDict_SetItem(builtin_dict, PyString_FromString(p_key.utf8().c_str()), Py_BuildValue("i", val));
-				} break;
-				case Variant::REAL: {
-					real_t val = p_val;
-		#ifdef REAL_T_IS_DOUBLE
-					PyDict_SetItem(builtin_dict, PyString_FromString(p_key.utf8().c_str()), Py_BuildValue("d", val));
-		#else
-					PyDict_SetItem(builtin_dict, PyString_FromString(p_key.utf8().c_str()), Py_BuildValue("f", val));
-		#endif
-				} break;
-				case Variant::STRING: {
-					String val = p_val;
-					PyDict_SetItemString(builtin_dict, p_key.utf8().c_str(), PyString_FromString(val.utf8().c_str()));
-				} break;
-				default: {
-					ret = false;
-				}
-			}
-			Py_XDECREF(builtin);
-		} else {
-			ret = false;
-		}
-		Py_XDECREF(name);
-	} else {
-		ret = false;
+	PyObject *key = PyString_InternFromString(p_key.utf8().get_data());
+	PyObject *val = pybind11::cast(p_val).release().ptr();
+	const bool ret = key && val && PyDict_SetItem(p_builtins, key, val) == 0;
+	Py_XDECREF(key);
+	Py_XDECREF(val);
+	if (!ret) {
+		WARN_PRINT("Failed to add builtin symbol " + p_key);
+		PyErr_Clear();
+	}
+	return ret;
+}
+
+static PyObject *_get_builtins_dict() {
+	PyObject *builtin = PyImport_AddModule("__builtin__"); // borrowed
+	return builtin ? PyModule_GetDict(builtin) : nullptr;
+}
+
+// New reference to gdgame, null (with a warning) if it cannot be imported
+static PyObject *_import_gdgame() {
+	PyObject *gdgame = PyImport_ImportModule("gdgame");
+	if (gdgame == nullptr) {
+		WARN_PRINT("Failed to import gdgame: builtin symbols are not added");
+		PyErr_Print();
 	}
+	return gdgame;
+}
+
+bool add_builtin_symbol(String p_key, Variant p_val) {
+	PyObject *builtins = _get_builtins_dict();
+	ERR_FAIL_NULL_V(builtins, false);
+	PyObject *gdgame = _import_gdgame();
+	if (gdgame == nullptr) {
+		return false;
+	}
+	const bool ret = _set_builtin_symbol(builtins, gdgame, p_key, p_val);
+	Py_DECREF(gdgame);
 	return ret;
 }
 
 bool add_builtin_symbols(Dictionary p_vals) {
+	if (p_vals.empty()) {
+		return true;
+	}
+	PyObject *builtins = _get_builtins_dict();
+	ERR_FAIL_NULL_V(builtins, false);
+	PyObject *gdgame = _import_gdgame(); // once for the whole batch
+	if (gdgame == nullptr) {
+		return false;
+	}
 	bool ret = true;
 	const Variant *key = nullptr;
 	while ((key = p_vals.next(key))) {
-		ret |= add_builtin_symbol(String(*key), p_vals[*key]);
+		ret &= _set_builtin_symbol(builtins, gdgame, String(*key), p_vals[*key]);
 	}
+	Py_DECREF(gdgame);
 	return ret;
 }
@@ -1,6 +1,7 @@
 #ifndef GODOT_CPYTHON_H
 #define GODOT_CPYTHON_H
 
+#include "core/hash_map.h"
 #include "core/reference.h"
 #include "core/variant.h"
 #include "scene/2d/node_2d.h"
@@ -8,6 +9,10 @@
 
 #include "pylib/godot/py_godot.h"
 
+#include <thread>
+#include <utility>
+#include <vector>
+
 class CPythonEngine : public Object {
 	GDCLASS(CPythonEngine, Object);
 
@@ -16,7 +21,38 @@ class CPythonEngine : public Object {
 
 	static CPythonEngine *instance;
 
+	void *_main_thread_state; // saved while main thread runs without interpreter lock
+
+	std::thread _init_thread; // background warm-up imports
+	std::vector<std::pair<String, uint64_t>> _init_timings; // of the init thread, published after join
+	Dictionary init_stats; // usec spent in initialization phases (main thread only)
+
+	enum SourceKind {
+		SOURCE_FILE,
+		SOURCE_MODULE,
+		SOURCE_CODE,
+	};
+
+	struct CompiledFile {
+		void *code;
+		uint64_t modified_time;
+	};
+
+	// compiled code objects: inline code is keyed by its content, scripts by path
+	HashMap<String, void *> code_cache;
+	HashMap<String, CompiledFile> file_cache;
+	HashMap<String, SourceKind> source_kinds;
+
+	void _initialize();
+	void _background_init(const Vector<String> &p_imports);
+	void _wait_background_init();
 	bool _add_path(const String &p_path, const String &p_object);
+	void *_compile_code(const String &p_python_code);
+	void *_compile_file(const String &p_python_file);
+	Error _exec_code(void *p_code, const char *p_filename);
+
+protected:
+	static void _bind_methods();
 
 public:
 	enum {
@@ -26,7 +62,12 @@ public:
 
 	static CPythonEngine *get_singleton();
 
+	void start_background_init(const Vector<String> &p_imports);
+	Dictionary get_init_stats() const { return init_stats; }
+
 	bool has_error();
+	void release_main_thread();
+	void clear_code_cache();
 
 	Error run_file(const String& p_python_file);
 	Error run_code(const String& p_python_code);
@@ -49,6 +90,12 @@ class CPythonInstance : public Node2D {
 	Array python_search_paths;
 	bool python_autorun;
 	String python_gd_build_func;
+	bool batch_events;
+	bool coalesce_motion;
+	bool batch_draw;
+	bool retained_draw;
+	bool threaded;
+	int thread_latency;
 	int debug_level;
 	int verboe_level;
 
@@ -62,6 +109,7 @@ protected:
 	void _get_property_list(List<PropertyInfo> *p_list) const;
 	void _notification(int p_what);
 	void _input(const Ref<InputEvent> &p_event);
+	Variant _resume_coroutine(const Variant **p_args, int p_argcount, Variant::CallError &r_error);
 	static void _bind_methods();
 
 public:
@@ -90,6 +138,21 @@ public:
 	bool is_autorun() const;
 	void set_gd_build_func(const String &p_func);
 	String get_gd_build_func() const;
+	void set_batch_events(bool p_batch);
+	bool is_batch_events() const;
+	void set_coalesce_motion(bool p_coalesce);
+	bool is_coalesce_motion() const;
+	void set_batch_draw(bool p_batch);
+	bool is_batch_draw() const;
+	void set_retained_draw(bool p_retained);
+	bool is_retained_draw() const;
+	void set_threaded(bool p_threaded);
+	bool is_threaded() const;
+	void set_thread_latency(int p_frames);
+	int get_thread_latency() const;
+	void set_frame_budget_msec(int p_msec);
+	int get_frame_budget_msec() const;
+	Dictionary get_budget_stats() const;
 	void set_debug_level(int p_level);
 	int get_debug_level() const;
 	void set_verbose_level(int p_level);
@@ -4,12 +4,18 @@
 #include "py_godot.h"
 
 #include "pybind11/pybind11.h"
+#include "py_casters.h"
+#include "py_pixels.h"
 
 #include "core/color.h"
+#include "core/engine.h"
+#include "core/hashfuncs.h"
 #include "core/image.h"
+#include "core/message_queue.h"
 #include "core/reference.h"
 #include "core/version.h"
 #include "core/os/os.h"
+#include "core/os/thread.h"
 #include "core/os/file_access.h"
 #include "core/os/keyboard.h"
 #include "core/io/resource_loader.h"
@@ -25,13 +31,27 @@
 #include "scene/resources/font.h"
 #include "scene/resources/dynamic_font.h"
 #include "scene/resources/theme.h"
+#include "servers/visual_server.h"
 #include "common/gd_core.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstdint>
+#include <deque>
+#include <functional>
 #include <iostream>
+#include <list>
+#include <map>
+#include <mutex>
 #include <string>
 #include <memory>
+#include <thread>
 #include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
 
 namespace py = pybind11;
 
@@ -82,7 +102,8 @@ static _FORCE_INLINE_ Color vec_to_color(const std::vector<float> &vec) {
 	return Color();
 }
 
-// Deferred rendering commands
+// Deferred rendering commands: plain data, resources and strings are referenced
+// by index into the tables of the queue
 struct RenderLaterCmd {
 	enum RenderLaterCmdType {
 		BLIT_AT_POINT,
@@ -90,34 +111,612 @@ struct RenderLaterCmd {
 		BLIT_AREA_AT_POINT,
 		BLIT_AREA_TO_RECT,
 		BLIT_COLOR_RECT,
-		BLIT_TEXT
+		BLIT_OUTLINE_RECT,
+		BLIT_TEXT,
+		BLIT_STYLE_BOX
 	};
 	RenderLaterCmdType cmd;
-	Ref<Texture> texture;
-	Ref<Font> font;
-	union {
-		Point2 pt_dest;
-		Rect2 rc_dest;
-	};
-	String text;
+	int resource; // texture, font or style box, -1 if none
+	int text; // string, -1 if none
+	Rect2 dest; // only position for *_AT_POINT and BLIT_TEXT
+	Rect2 area; // BLIT_OUTLINE_RECT keeps width in area.position.x
 	Color color;
-	Rect2 area;
-
-	RenderLaterCmd(const Ref<Texture> &t, const Point2 &p) : cmd(BLIT_AT_POINT), texture(t), pt_dest(p) { }
-	RenderLaterCmd(const Ref<Texture> &t, const Rect2 &r) : cmd(BLIT_TO_RECT), texture(t), rc_dest(r) { }
-	RenderLaterCmd(const Ref<Texture> &t, const Point2 &p, const Rect2 &a) : cmd(BLIT_AREA_AT_POINT), texture(t), pt_dest(p), area(a) { }
-	RenderLaterCmd(const Ref<Texture> &t, const Rect2 &r, const Rect2 &a) : cmd(BLIT_AREA_TO_RECT), texture(t), rc_dest(r), area(a) { }
-	RenderLaterCmd(const Rect2 &r, const Color &c) : cmd(BLIT_COLOR_RECT), rc_dest(r), color(c) { }
-	RenderLaterCmd(const Ref<Font> &f, const String &t, const Point2 &p, const Color &c) : cmd(BLIT_TEXT), font(f), pt_dest(p), text(t), color(c) { }
 };
 
+static_assert(std::is_trivially_copyable<RenderLaterCmd>::value && std::is_trivially_destructible<RenderLaterCmd>::value, "RenderLaterCmd must be plain data");
+
+// Stream of deferred commands. Storage is shared between copies until one of
+// them is modified (copy on write) and clear() keeps the allocated memory,
+// so per-frame lists do not allocate once they reached their size.
+struct GdRenderQueue {
+	struct Data {
+		std::vector<RenderLaterCmd> commands;
+		std::vector<Ref<Reference>> resources;
+		std::vector<String> strings;
+		std::unordered_map<const Reference *, int> resource_index;
+	};
+
+	std::shared_ptr<Data> _data;
+
+	_FORCE_INLINE_ Data *_write() {
+		if (!_data) {
+			_data = std::make_shared<Data>();
+		} else if (_data.use_count() > 1) {
+			_data = std::make_shared<Data>(*_data); // detach shared storage
+		}
+		return _data.get();
+	}
+
+	// resource is referenced only once per queue
+	_FORCE_INLINE_ int _resource(Data *d, Reference *p_res) {
+		if (p_res == nullptr) {
+			return -1;
+		}
+		auto it = d->resource_index.find(p_res);
+		if (it != d->resource_index.end()) {
+			return it->second;
+		}
+		const int index = d->resources.size();
+		d->resources.push_back(Ref<Reference>(p_res));
+		d->resource_index[p_res] = index;
+		return index;
+	}
+
+	_FORCE_INLINE_ RenderLaterCmd &_push(RenderLaterCmd::RenderLaterCmdType p_cmd, Reference *p_res, const Rect2 &p_dest, const Rect2 &p_area = Rect2(), const Color &p_color = Color(1, 1, 1, 1)) {
+		Data *d = _write();
+		d->commands.push_back({ p_cmd, _resource(d, p_res), -1, p_dest, p_area, p_color });
+		return d->commands.back();
+	}
+
+	_FORCE_INLINE_ void push(const Ref<Texture> &t, const Point2 &p) { _push(RenderLaterCmd::BLIT_AT_POINT, t.ptr(), Rect2(p, Size2())); }
+	_FORCE_INLINE_ void push(const Ref<Texture> &t, const Rect2 &r) { _push(RenderLaterCmd::BLIT_TO_RECT, t.ptr(), r); }
+	_FORCE_INLINE_ void push(const Ref<Texture> &t, const Point2 &p, const Rect2 &a) { _push(RenderLaterCmd::BLIT_AREA_AT_POINT, t.ptr(), Rect2(p, Size2()), a); }
+	_FORCE_INLINE_ void push(const Ref<Texture> &t, const Rect2 &r, const Rect2 &a, const Color &c = Color(1, 1, 1, 1)) { _push(RenderLaterCmd::BLIT_AREA_TO_RECT, t.ptr(), r, a, c); }
+	_FORCE_INLINE_ void push(const Rect2 &r, const Color &c) { _push(RenderLaterCmd::BLIT_COLOR_RECT, nullptr, r, Rect2(), c); }
+	_FORCE_INLINE_ void push(const Rect2 &r, const Color &c, real_t w) { _push(RenderLaterCmd::BLIT_OUTLINE_RECT, nullptr, r, Rect2(w, 0, 0, 0), c); }
+	_FORCE_INLINE_ void push(const Ref<StyleBox> &s, const Rect2 &r) { _push(RenderLaterCmd::BLIT_STYLE_BOX, s.ptr(), r); }
+	_FORCE_INLINE_ void push(const Ref<Font> &f, const String &t, const Point2 &p, const Color &c) {
+		RenderLaterCmd &cmd = _push(RenderLaterCmd::BLIT_TEXT, f.ptr(), Rect2(p, Size2()), Rect2(), c);
+		cmd.text = _data->strings.size();
+		_data->strings.push_back(t);
+	}
+
+	// Append commands of another queue (re-indexing its tables), moved by offset
+	void append(const GdRenderQueue &p_queue, const Point2 &p_offset = Point2()) {
+		if (p_queue.empty()) {
+			return;
+		}
+		if (empty() && p_offset == Point2()) {
+			_data = p_queue._data; // share
+			return;
+		}
+		Data *d = _write();
+		const Data *s = p_queue._data.get();
+		for (RenderLaterCmd c : s->commands) {
+			if (c.resource >= 0) {
+				c.resource = _resource(d, s->resources[c.resource].ptr());
+			}
+			if (c.text >= 0) {
+				const int index = d->strings.size();
+				d->strings.push_back(s->strings[c.text]);
+				c.text = index;
+			}
+			c.dest.position += p_offset;
+			d->commands.push_back(c);
+		}
+	}
+
+	// Frame reset: owned storage is kept for reuse
+	_FORCE_INLINE_ void clear() {
+		if (_data && _data.use_count() == 1) {
+			_data->commands.clear();
+			_data->resources.clear();
+			_data->strings.clear();
+			_data->resource_index.clear();
+		} else {
+			_data.reset();
+		}
+	}
+
+	_FORCE_INLINE_ size_t size() const { return _data ? _data->commands.size() : 0; }
+	_FORCE_INLINE_ bool empty() const { return size() == 0; }
+	_FORCE_INLINE_ const RenderLaterCmd *begin() const { return _data ? _data->commands.data() : nullptr; }
+	_FORCE_INLINE_ const RenderLaterCmd *end() const { return _data ? _data->commands.data() + _data->commands.size() : nullptr; }
+
+	_FORCE_INLINE_ Reference *resource(const RenderLaterCmd &c) const { return c.resource >= 0 ? _data->resources[c.resource].ptr() : nullptr; }
+	// resource type follows from the command type
+	_FORCE_INLINE_ Texture *texture(const RenderLaterCmd &c) const { return static_cast<Texture *>(resource(c)); }
+	_FORCE_INLINE_ Font *font(const RenderLaterCmd &c) const { return static_cast<Font *>(resource(c)); }
+	_FORCE_INLINE_ StyleBox *style_box(const RenderLaterCmd &c) const { return static_cast<StyleBox *>(resource(c)); }
+	_FORCE_INLINE_ const String &text(const RenderLaterCmd &c) const {
+		static const String _empty;
+		return c.text >= 0 ? _data->strings[c.text] : _empty;
+	}
+};
+
+// Draw calls issued by render queues (last complete frame)
+struct _RenderStats {
+	uint64_t frame = 0;
+	int commands = 0, draw_calls = 0, layers_updated = 0, layers_kept = 0;
+	int last_commands = 0, last_draw_calls = 0, last_layers_updated = 0, last_layers_kept = 0;
+
+	_FORCE_INLINE_ void _roll() {
+		const uint64_t current = Engine::get_singleton()->get_frames_drawn();
+		if (current != frame) {
+			last_commands = commands;
+			last_draw_calls = draw_calls;
+			last_layers_updated = layers_updated;
+			last_layers_kept = layers_kept;
+			commands = draw_calls = layers_updated = layers_kept = 0;
+			frame = current;
+		}
+	}
+	_FORCE_INLINE_ void add(int p_commands, int p_draw_calls) {
+		_roll();
+		commands += p_commands;
+		draw_calls += p_draw_calls;
+	}
+	_FORCE_INLINE_ void add_layers(int p_updated, int p_kept) {
+		_roll();
+		layers_updated += p_updated;
+		layers_kept += p_kept;
+	}
+} _render_stats;
+
+// Composed surface flattened into a render target: queued commands are drawn
+// once into an offscreen viewport (rendered on the next frame) and the surface
+// is then blitted as a single texture. Viewport is released with the texture.
+class GdBakedTexture : public Texture {
+	GDCLASS(GdBakedTexture, Texture);
+
+	RID viewport, canvas, item;
+	int width, height;
+	uint64_t frame;
+
+public:
+	int get_width() const { return width; }
+	int get_height() const { return height; }
+	RID get_rid() const { return VisualServer::get_singleton()->viewport_get_texture(viewport); }
+	bool has_alpha() const { return true; }
+	void set_flags(uint32_t p_flags) { }
+	uint32_t get_flags() const { return 0; }
+
+	_FORCE_INLINE_ RID get_canvas_item() const { return item; }
+	// viewport content is available after it was drawn
+	_FORCE_INLINE_ bool is_ready() const { return Engine::get_singleton()->get_frames_drawn() > frame; }
+
+	// Items were added: viewport is drawn again (previous content is kept until then)
+	void redraw() {
+		VisualServer::get_singleton()->viewport_set_update_mode(viewport, VisualServer::VIEWPORT_UPDATE_ONCE);
+		frame = Engine::get_singleton()->get_frames_drawn();
+	}
+
+	GdBakedTexture(int p_width = 1, int p_height = 1) : width(MAX(p_width, 1)), height(MAX(p_height, 1)) {
+		VisualServer *vs = VisualServer::get_singleton();
+		viewport = vs->viewport_create();
+		vs->viewport_set_size(viewport, width, height);
+		vs->viewport_set_usage(viewport, VisualServer::VIEWPORT_USAGE_2D);
+		vs->viewport_set_transparent_background(viewport, true);
+		vs->viewport_set_vflip(viewport, true);
+		vs->viewport_set_update_mode(viewport, VisualServer::VIEWPORT_UPDATE_ONCE);
+		vs->viewport_set_active(viewport, true);
+		canvas = vs->canvas_create();
+		vs->viewport_attach_canvas(viewport, canvas);
+		item = vs->canvas_item_create();
+		vs->canvas_item_set_parent(item, canvas);
+		frame = Engine::get_singleton()->get_frames_drawn();
+	}
+
+	~GdBakedTexture() {
+		VisualServer *vs = VisualServer::get_singleton();
+		vs->free(item);
+		vs->viewport_remove_canvas(viewport, canvas);
+		vs->free(canvas);
+		vs->free(viewport);
+	}
+};
+
+// Engine calls of the thread recording frames in threaded mode: fonts,
+// resources and nodes are used by the main thread only, so the worker posts
+// the call and waits for it (without the interpreter lock). Main thread runs
+// posted calls while waiting for the worker and in its process and draw
+// callbacks (see PyGodotInstance::sync_thread and draw_thread).
+struct GdMainCalls {
+	std::mutex &mutex; // shared with the worker
+	std::condition_variable &cond;
+	std::deque<std::pair<const std::function<void()> *, bool *>> posted;
+
+	GdMainCalls(std::mutex &p_mutex, std::condition_variable &p_cond) : mutex(p_mutex), cond(p_cond) { }
+
+	// Set on the worker thread only
+	static _FORCE_INLINE_ GdMainCalls *&current() {
+		static thread_local GdMainCalls *_current = nullptr;
+		return _current;
+	}
+
+	// Run on the main thread (called directly anywhere but on the worker)
+	static void run(const std::function<void()> &p_func) {
+		GdMainCalls *calls = current();
+		if (calls == nullptr) {
+			p_func();
+			return;
+		}
+		bool done = false;
+		PyThreadState *tstate = PyEval_SaveThread();
+		{
+			std::unique_lock<std::mutex> lock(calls->mutex);
+			calls->posted.emplace_back(&p_func, &done);
+			calls->cond.notify_all();
+			calls->cond.wait(lock, [&done] { return done; });
+		}
+		PyEval_RestoreThread(tstate);
+	}
+
+	// Main thread with the lock held
+	void run_posted(std::unique_lock<std::mutex> &lock) {
+		while (!posted.empty()) {
+			const auto call = posted.front();
+			posted.pop_front();
+			lock.unlock();
+			(*call.first)();
+			lock.lock();
+			*call.second = true;
+			cond.notify_all();
+		}
+	}
+
+	// Main thread waiting for the worker runs its calls meanwhile
+	template <typename P>
+	void wait(std::unique_lock<std::mutex> &lock, P p_pred) {
+		run_posted(lock);
+		while (!p_pred()) {
+			cond.wait(lock);
+			run_posted(lock);
+		}
+	}
+};
+
+// Strings measured and laid out once: glyphs with their offsets are kept in
+// LRU cache keyed by font, text and color (entry also keeps text baked into
+// a label page, see GdLabelBaker). Shared by the Python and main thread.
+struct GdTextCache {
+	static const int CAPACITY = 256;
+
+	struct Glyph {
+		CharType c, next;
+		real_t x;
+	};
+
+	struct Entry {
+		Ref<Font> font;
+		String text;
+		Color color;
+		Size2 size;
+		std::vector<Glyph> glyphs;
+		Ref<Texture> baked; // region of a label page (own texture if larger)
+
+		// Same as Font::draw (outline first) without measuring characters again
+		void draw(const RID &p_item, const Point2 &p_pos, const Color &p_modulate) const {
+			if (font->has_outline()) {
+				for (const Glyph &g : glyphs) {
+					font->draw_char(p_item, p_pos + Vector2(g.x, 0), g.c, g.next, Color(1, 1, 1), true);
+				}
+			}
+			for (const Glyph &g : glyphs) {
+				font->draw_char(p_item, p_pos + Vector2(g.x, 0), g.c, g.next, p_modulate, false);
+			}
+		}
+	};
+
+	struct Key {
+		const Font *font;
+		String text;
+		uint32_t color;
+
+		bool operator==(const Key &p_key) const { return font == p_key.font && color == p_key.color && text == p_key.text; }
+	};
+
+	struct KeyHash {
+		size_t operator()(const Key &p_key) const {
+			return hash_djb2_one_32(p_key.color, hash_djb2_one_64(uint64_t(p_key.font), p_key.text.hash()));
+		}
+	};
+
+	typedef std::list<std::pair<Key, std::shared_ptr<Entry>>> List;
+
+	List lru; // most recently used first
+	std::unordered_map<Key, List::iterator, KeyHash> index;
+	std::mutex mutex;
+	uint64_t hits = 0, misses = 0;
+
+	std::shared_ptr<Entry> get(const Ref<Font> &p_font, const String &p_text, const Color &p_color) {
+		ERR_FAIL_NULL_V(p_font, std::shared_ptr<Entry>());
+		const Key key = { p_font.ptr(), p_text, p_color.to_rgba32() };
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			auto it = index.find(key);
+			if (it != index.end()) {
+				hits++;
+				lru.splice(lru.begin(), lru, it->second);
+				return it->second->second;
+			}
+			misses++;
+		}
+		std::shared_ptr<Entry> entry = std::make_shared<Entry>();
+		entry->font = p_font;
+		entry->text = p_text;
+		entry->color = p_color;
+		entry->glyphs.reserve(p_text.length());
+		// measuring fills glyph caches of the font (main thread, cache unlocked)
+		GdMainCalls::run([&entry, &p_font, &p_text] {
+			real_t x = 0;
+			for (int i = 0; i < p_text.length(); i++) {
+				const Glyph g = { p_text[i], p_text[i + 1], x };
+				entry->glyphs.push_back(g);
+				x += p_font->get_char_size(g.c, g.next).width;
+			}
+			entry->size = Size2(x, p_font->get_height());
+		});
+		std::lock_guard<std::mutex> lock(mutex);
+		auto it = index.find(key);
+		if (it != index.end()) {
+			return it->second->second; // measured by the other thread meanwhile
+		}
+		lru.push_front(std::make_pair(key, entry));
+		index[key] = lru.begin();
+		if (int(lru.size()) > CAPACITY) {
+			index.erase(lru.back().first);
+			lru.pop_back();
+		}
+		return entry;
+	}
+
+	void clear() {
+		std::lock_guard<std::mutex> lock(mutex);
+		index.clear();
+		lru.clear();
+	}
+
+	size_t size() {
+		std::lock_guard<std::mutex> lock(mutex);
+		return lru.size();
+	}
+} _text_cache;
+
+// Replays render queue merging textured and color quads into triangle arrays,
+// one per texture. Quad can be moved to an earlier batch with the same texture
+// only if it does not overlap any batch drawn in between. Text and outlines
+// are drawn directly and break the batching.
+struct GdRenderBatcher {
+	static const int LOOKBACK = 8; // batches searched for matching texture
+
+	struct Batch {
+		RID texture;
+		Size2 uv_scale;
+		Rect2 bounds;
+		Vector<int> indices;
+		Vector<Point2> points;
+		Vector<Point2> uvs;
+		Vector<Color> colors;
+	};
+
+	std::vector<Batch> batches;
+	int commands = 0, draw_calls = 0;
+
+	static _FORCE_INLINE_ bool &enabled() {
+		static bool _enabled = true;
+		return _enabled;
+	}
+
+	void add_quad(const RID &p_texture, const Rect2 &p_dest, const Rect2 &p_uv, const Color &p_color) {
+		commands++;
+		Batch *batch = nullptr;
+		for (int i = int(batches.size()) - 1, n = 0; i >= 0 && n < LOOKBACK; i--, n++) {
+			if (batches[i].texture == p_texture) {
+				batch = &batches[i];
+				break;
+			}
+			if (batches[i].bounds.intersects(p_dest)) {
+				break; // would change drawing order
+			}
+		}
+		if (batch == nullptr) {
+			batches.push_back(Batch());
+			batch = &batches.back();
+			batch->texture = p_texture;
+			batch->bounds = p_dest;
+			if (p_texture.is_valid()) {
+				VisualServer *vs = VisualServer::get_singleton();
+				batch->uv_scale = Size2(1.0 / MAX(vs->texture_get_width(p_texture), 1), 1.0 / MAX(vs->texture_get_height(p_texture), 1));
+			}
+		} else {
+			batch->bounds = batch->bounds.merge(p_dest);
+		}
+		const int base = batch->points.size();
+		const Point2 corners[4] = { Point2(0, 0), Point2(1, 0), Point2(1, 1), Point2(0, 1) };
+		for (int c = 0; c < 4; c++) {
+			batch->points.push_back(p_dest.position + p_dest.size * corners[c]);
+			batch->uvs.push_back((p_uv.position + p_uv.size * corners[c]) * batch->uv_scale);
+			batch->colors.push_back(p_color);
+		}
+		const int quad[6] = { 0, 1, 2, 0, 2, 3 };
+		for (int q = 0; q < 6; q++) {
+			batch->indices.push_back(base + quad[q]);
+		}
+	}
+
+	void add_texture(const Texture *p_texture, const Rect2 &p_dest, const Rect2 &p_src, const Color &p_color = Color(1, 1, 1, 1)) {
+		if (p_texture == nullptr) {
+			return;
+		}
+		Rect2 dest, src;
+		if (p_texture->get_rect_region(p_dest, p_src, dest, src)) { // resolve atlas regions
+			add_quad(p_texture->get_rid(), dest, src, p_color);
+		}
+	}
+
+	void flush(const RID &p_item) {
+		VisualServer *vs = VisualServer::get_singleton();
+		for (Batch &batch : batches) {
+			vs->canvas_item_add_triangle_array(p_item, batch.indices, batch.points, batch.colors, batch.uvs, Vector<int>(), Vector<float>(), batch.texture);
+			draw_calls++;
+		}
+		batches.clear();
+	}
+
+	void render(const RID &p_item, const GdRenderQueue &p_queue) {
+		for (const auto &c : p_queue) {
+			switch (c.cmd) {
+				case RenderLaterCmd::BLIT_AT_POINT: {
+					if (const Texture *texture = p_queue.texture(c)) {
+						add_texture(texture, Rect2(c.dest.position, texture->get_size()), Rect2(Point2(), texture->get_size()));
+					}
+				} break;
+				case RenderLaterCmd::BLIT_TO_RECT: {
+					if (const Texture *texture = p_queue.texture(c)) {
+						add_texture(texture, c.dest, Rect2(Point2(), texture->get_size()));
+					}
+				} break;
+				case RenderLaterCmd::BLIT_AREA_AT_POINT: add_texture(p_queue.texture(c), Rect2(c.dest.position, c.area.size), c.area); break;
+				case RenderLaterCmd::BLIT_AREA_TO_RECT: add_texture(p_queue.texture(c), c.dest, c.area, c.color); break;
+				case RenderLaterCmd::BLIT_COLOR_RECT: add_quad(RID(), c.dest, Rect2(), c.color); break;
+				case RenderLaterCmd::BLIT_OUTLINE_RECT: {
+					flush(p_item);
+					// same as CanvasItem::draw_rect (not filled)
+					VisualServer *vs = VisualServer::get_singleton();
+					const Rect2 &r = c.dest;
+					const real_t width = c.area.position.x, offset = width / 2.0;
+					vs->canvas_item_add_line(p_item, r.position + Size2(-offset, 0), r.position + Size2(r.size.width + offset, 0), c.color, width);
+					vs->canvas_item_add_line(p_item, r.position + Size2(r.size.width, offset), r.position + Size2(r.size.width, r.size.height - offset), c.color, width);
+					vs->canvas_item_add_line(p_item, r.position + Size2(r.size.width + offset, r.size.height), r.position + Size2(-offset, r.size.height), c.color, width);
+					vs->canvas_item_add_line(p_item, r.position + Size2(0, r.size.height - offset), r.position + Size2(0, offset), c.color, width);
+					commands++;
+					draw_calls += 4;
+				} break;
+				case RenderLaterCmd::BLIT_TEXT: {
+					flush(p_item);
+					if (Font *font = p_queue.font(c)) {
+						if (std::shared_ptr<GdTextCache::Entry> shaped = _text_cache.get(font, p_queue.text(c), c.color)) {
+							shaped->draw(p_item, c.dest.position + Vector2(0, font->get_ascent()), c.color);
+						}
+					}
+					commands++;
+					draw_calls++;
+				} break;
+				case RenderLaterCmd::BLIT_STYLE_BOX: {
+					flush(p_item);
+					if (StyleBox *style = p_queue.style_box(c)) {
+						style->draw(p_item, c.dest);
+					}
+					commands++;
+					draw_calls++;
+				} break;
+			}
+		}
+		finish(p_item);
+	}
+
+	// Flush pending batches and account the submitted commands
+	void finish(const RID &p_item) {
+		flush(p_item);
+		_render_stats.add(commands, draw_calls);
+		commands = draw_calls = 0;
+	}
+};
+
+// Free list of memory blocks for one surface type: surfaces created and
+// released every frame reuse the same blocks instead of going to the heap.
+// Creation and destruction happens with the interpreter lock held, mutex
+// only guards engine threads (e.g. worker recording).
+template <typename T>
+struct GdPool {
+	static const int MAX_FREE = 1024; // blocks kept for reuse
+
+	std::vector<void *> free_list;
+	std::mutex mutex;
+	uint64_t allocated = 0, reused = 0, released = 0;
+	int64_t live = 0, peak = 0;
+
+	static _FORCE_INLINE_ GdPool &get() {
+		static GdPool _pool;
+		return _pool;
+	}
+
+	void *alloc(size_t p_size) {
+		if (p_size != sizeof(T)) {
+			return ::operator new(p_size); // derived type
+		}
+		std::lock_guard<std::mutex> lock(mutex);
+		void *ptr;
+		if (free_list.empty()) {
+			ptr = ::operator new(sizeof(T));
+			allocated++;
+		} else {
+			ptr = free_list.back();
+			free_list.pop_back();
+			reused++;
+		}
+		peak = MAX(peak, ++live);
+		return ptr;
+	}
+
+	void release(void *p_ptr, size_t p_size) {
+		if (p_ptr == nullptr) {
+			return;
+		}
+		if (p_size != sizeof(T)) {
+			::operator delete(p_ptr);
+			return;
+		}
+		std::lock_guard<std::mutex> lock(mutex);
+		live--;
+		released++;
+		if (int(free_list.size()) < MAX_FREE) {
+			free_list.push_back(p_ptr);
+		} else {
+			::operator delete(p_ptr);
+		}
+	}
+
+	// Keep only as many free blocks as the busiest frame needed
+	void trim() {
+		std::lock_guard<std::mutex> lock(mutex);
+		while (int64_t(free_list.size()) > peak - live && !free_list.empty()) {
+			::operator delete(free_list.back());
+			free_list.pop_back();
+		}
+		peak = live;
+	}
+
+	py::dict get_stats() {
+		std::lock_guard<std::mutex> lock(mutex);
+		return py::dict(
+				py::arg("allocated") = allocated,
+				py::arg("reused") = reused,
+				py::arg("released") = released,
+				py::arg("live") = live,
+				py::arg("pooled") = free_list.size());
+	}
+
+	~GdPool() {
+		for (void *ptr : free_list) {
+			::operator delete(ptr);
+		}
+	}
+};
+
+#define GD_POOLED(m_type)                                                                             \
+	static void *operator new(size_t p_size) { return GdPool<m_type>::get().alloc(p_size); }         \
+	static void operator delete(void *p_ptr, size_t p_size) { GdPool<m_type>::get().release(p_ptr, p_size); }
+
 // Available Surface types
 struct GdSurfaceImpl {
 	enum Type {
 		TEXTURE_SURFACE,
 		TEXT_SURFACE,
 		COLOR_SURFACE,
-		DISPLAY_SURFACE
+		DISPLAY_SURFACE,
+		IMAGE_SURFACE
 	};
 
 	virtual Type get_surface_type() const = 0;
@@ -131,6 +730,8 @@ struct GdSurfaceImpl {
 };
 
 struct GdColorSurface : public GdSurfaceImpl {
+	GD_POOLED(GdColorSurface)
+
 	int surf_width, surf_height;
 	std::unique_ptr<Color> surf_color; // no drawing if null
 
@@ -138,35 +739,258 @@ struct GdColorSurface : public GdSurfaceImpl {
 	_FORCE_INLINE_ int get_width() const { return surf_width; }
 	_FORCE_INLINE_ int get_height() const { return surf_height; }
 
-	_FORCE_INLINE_ std::unique_ptr<GdSurfaceImpl> clone() const { return std::make_unique<GdColorSurface>(surf_width, surf_height, *surf_color); }
+	_FORCE_INLINE_ std::unique_ptr<GdSurfaceImpl> clone() const {
+		return surf_color ? std::make_unique<GdColorSurface>(surf_width, surf_height, *surf_color) : std::make_unique<GdColorSurface>(surf_width, surf_height);
+	}
 
 	GdColorSurface(int width, int height) : surf_width(width), surf_height(height) { }
 	GdColorSurface(int width, int height, const Color &color) : surf_width(width), surf_height(height), surf_color(std::make_unique<Color>(color)) { }
 };
 
 struct GdTextSurface : public GdSurfaceImpl {
+	GD_POOLED(GdTextSurface)
+
 	Ref<Font> font;
 	String text;
 	Color color;
 
 	Size2 text_size = Size2(1, 1);
+	std::shared_ptr<GdTextCache::Entry> shaped;
 
 	_FORCE_INLINE_ Type get_surface_type() const { return TEXT_SURFACE; }
 	_FORCE_INLINE_ int get_width() const { ERR_FAIL_NULL_V(font, 1); return text_size.width; }
 	_FORCE_INLINE_ int get_height() const { ERR_FAIL_NULL_V(font, 1); return text_size.height; }
 
-	_FORCE_INLINE_ std::unique_ptr<GdSurfaceImpl> clone() const { return std::make_unique<GdTextSurface>(font, text, color); }
+	_FORCE_INLINE_ std::unique_ptr<GdSurfaceImpl> clone() const { return std::make_unique<GdTextSurface>(*this); }
 
 	GdTextSurface(const Ref<Font> &font, const String &text, const Color &color) : font(font), text(text), color(color) {
 		if (font) {
-			text_size = font->get_string_size(text);
+			shaped = _text_cache.get(font, text, color);
+			text_size = shaped->size;
+		}
+	}
+};
+
+// Pixel addressable surface (RGBA8 in memory). Changed rows are uploaded to
+// the texture when the surface is drawn (main thread only).
+struct GdImageSurface : public GdSurfaceImpl {
+	GD_POOLED(GdImageSurface)
+
+	int surf_width, surf_height;
+	std::vector<uint32_t> pixels;
+	bool has_colorkey = false;
+	uint32_t colorkey = 0;
+	std::vector<uint32_t> palette;
+	int dirty_top = 0, dirty_bottom = 0; // rows [top, bottom) changed since upload
+	int views = 0; // exported pixel buffers, writes through them are not tracked
+	uint64_t version = 0; // changes with pixels
+	Ref<ImageTexture> texture;
+	Ref<ImageTexture> frozen; // copy of pixels at frozen_version (see snapshot)
+	uint64_t frozen_version = 0;
+
+	_FORCE_INLINE_ Type get_surface_type() const { return IMAGE_SURFACE; }
+	_FORCE_INLINE_ int get_width() const { return surf_width; }
+	_FORCE_INLINE_ int get_height() const { return surf_height; }
+
+	_FORCE_INLINE_ std::unique_ptr<GdSurfaceImpl> clone() const { return std::make_unique<GdImageSurface>(*this); }
+
+	static _FORCE_INLINE_ uint32_t pack(const Color &c) { return c.to_abgr32(); } // bytes R, G, B, A
+	static _FORCE_INLINE_ Color unpack(uint32_t p) { return Color((p & 0xff) / 255.0, ((p >> 8) & 0xff) / 255.0, ((p >> 16) & 0xff) / 255.0, (p >> 24) / 255.0); }
+
+	_FORCE_INLINE_ uint32_t *row(int y) { return pixels.data() + size_t(y) * surf_width; }
+	_FORCE_INLINE_ const uint32_t *row(int y) const { return pixels.data() + size_t(y) * surf_width; }
+
+	_FORCE_INLINE_ void mark_dirty(int top, int bottom) {
+		version++;
+		if (dirty_top >= dirty_bottom) {
+			dirty_top = top;
+			dirty_bottom = bottom;
+		} else {
+			dirty_top = MIN(dirty_top, top);
+			dirty_bottom = MAX(dirty_bottom, bottom);
+		}
+	}
+	_FORCE_INLINE_ void mark_dirty() { mark_dirty(0, surf_height); }
+
+	// Clip destination rectangle (and source offset) to the surface
+	_FORCE_INLINE_ bool clip(int &x, int &y, int &w, int &h, int *sx = nullptr, int *sy = nullptr) const {
+		if (x < 0) {
+			w += x;
+			if (sx) {
+				*sx -= x;
+			}
+			x = 0;
+		}
+		if (y < 0) {
+			h += y;
+			if (sy) {
+				*sy -= y;
+			}
+			y = 0;
+		}
+		w = MIN(w, surf_width - x);
+		h = MIN(h, surf_height - y);
+		return w > 0 && h > 0;
+	}
+
+	void fill(const Color &color, int x, int y, int w, int h) {
+		if (!clip(x, y, w, h)) {
+			return;
+		}
+		const uint32_t value = pack(color);
+		for (int r = y; r < y + h; r++) {
+			pixels::fill_row(row(r) + x, w, value);
+		}
+		mark_dirty(y, y + h);
+	}
+
+	// Color blended over the rectangle (filled when opaque)
+	void blend(const Color &color, int x, int y, int w, int h) {
+		if (color.a >= 1) {
+			fill(color, x, y, w, h);
+			return;
+		}
+		if (!clip(x, y, w, h)) {
+			return;
+		}
+		std::vector<uint32_t> src(w, pack(color));
+		for (int r = y; r < y + h; r++) {
+			pixels::blend_row(row(r) + x, src.data(), w);
+		}
+		mark_dirty(y, y + h);
+	}
+
+	// Source area drawn at x, y: colorkey pixels are skipped, otherwise alpha blended
+	void blit(const GdImageSurface &src, int x, int y, int sx, int sy, int w, int h) {
+		if (sx < 0) {
+			w += sx, x -= sx, sx = 0;
 		}
+		if (sy < 0) {
+			h += sy, y -= sy, sy = 0;
+		}
+		w = MIN(w, src.surf_width - sx);
+		h = MIN(h, src.surf_height - sy);
+		if (!clip(x, y, w, h, &sx, &sy)) {
+			return;
+		}
+		std::vector<uint32_t> tmp;
+		if (&src == this) { // overlapping rows
+			tmp.resize(size_t(w) * h);
+			for (int r = 0; r < h; r++) {
+				pixels::copy_row(tmp.data() + size_t(r) * w, src.row(sy + r) + sx, w);
+			}
+		}
+		for (int r = 0; r < h; r++) {
+			const uint32_t *s = tmp.empty() ? src.row(sy + r) + sx : tmp.data() + size_t(r) * w;
+			if (src.has_colorkey) {
+				pixels::colorkey_row(row(y + r) + x, s, w, src.colorkey);
+			} else {
+				pixels::blend_row(row(y + r) + x, s, w);
+			}
+		}
+		mark_dirty(y, y + h);
+	}
+
+	// 8-bit indices converted with the palette (pitch in bytes)
+	void set_indices(const uint8_t *src, int pitch, int x, int y, int w, int h) {
+		int sx = 0, sy = 0;
+		if (!clip(x, y, w, h, &sx, &sy)) {
+			return;
+		}
+		for (int r = 0; r < h; r++) {
+			pixels::palette_row(row(y + r) + x, src + size_t(sy + r) * pitch + sx, w, palette.data(), palette.size());
+		}
+		mark_dirty(y, y + h);
 	}
+
+	_FORCE_INLINE_ Color get_at(int x, int y) const {
+		ERR_FAIL_INDEX_V(x, surf_width, Color());
+		ERR_FAIL_INDEX_V(y, surf_height, Color());
+		return unpack(row(y)[x]);
+	}
+
+	_FORCE_INLINE_ void set_at(int x, int y, const Color &color) {
+		ERR_FAIL_INDEX(x, surf_width);
+		ERR_FAIL_INDEX(y, surf_height);
+		row(y)[x] = pack(color);
+		mark_dirty(y, y + 1);
+	}
+
+	// Texture with current pixels: only dirty rows are uploaded
+	Ref<Texture> get_texture() {
+		if (Thread::get_caller_id() != Thread::get_main_id()) {
+			WARN_PRINT_ONCE("Image surface cannot be uploaded from a thread (threaded drawing)");
+			return texture;
+		}
+		if (views > 0) {
+			mark_dirty();
+		}
+		if (texture.is_null()) {
+			texture.instance();
+			texture->create(surf_width, surf_height, Image::FORMAT_RGBA8, 0); // no filter and mipmaps (partial updates)
+			mark_dirty();
+		}
+		if (dirty_top < dirty_bottom) {
+			const int rows = dirty_bottom - dirty_top;
+			PoolVector<uint8_t> data;
+			data.resize(surf_width * rows * sizeof(uint32_t));
+			memcpy(data.write().ptr(), row(dirty_top), data.size());
+			Ref<Image> image = memnew(Image(surf_width, rows, false, Image::FORMAT_RGBA8, data));
+			if (rows == surf_height) {
+				texture->set_data(image);
+			} else {
+				VisualServer::get_singleton()->texture_set_data_partial(texture->get_rid(), image, 0, 0, surf_width, rows, 0, dirty_top, 0);
+			}
+			dirty_top = dirty_bottom = 0;
+		}
+		return texture;
+	}
+
+	// Texture with a copy of current pixels for queued blits, which must not
+	// follow later changes of the surface (shared until the pixels change)
+	Ref<Texture> snapshot() {
+		if (Thread::get_caller_id() != Thread::get_main_id()) {
+			WARN_PRINT_ONCE("Image surface cannot be uploaded from a thread (threaded drawing)");
+			return frozen;
+		}
+		if (views > 0) {
+			mark_dirty();
+		}
+		if (frozen.is_null() || frozen_version != version) {
+			PoolVector<uint8_t> data;
+			data.resize(pixels.size() * sizeof(uint32_t));
+			memcpy(data.write().ptr(), pixels.data(), data.size());
+			frozen.instance(); // new texture, queued blits keep the previous one
+			frozen->create_from_image(memnew(Image(surf_width, surf_height, false, Image::FORMAT_RGBA8, data)), 0);
+			frozen_version = version;
+		}
+		return frozen;
+	}
+
+	GdImageSurface(int width, int height) : surf_width(MAX(width, 1)), surf_height(MAX(height, 1)), pixels(size_t(surf_width) * surf_height, 0) { }
+	GdImageSurface(const Ref<Image> &p_image) : surf_width(1), surf_height(1) {
+		ERR_FAIL_NULL(p_image);
+		Ref<Image> image = p_image->duplicate();
+		if (image->is_compressed()) {
+			image->decompress();
+		}
+		image->clear_mipmaps();
+		image->convert(Image::FORMAT_RGBA8);
+		surf_width = image->get_width();
+		surf_height = image->get_height();
+		pixels.resize(size_t(surf_width) * surf_height);
+		PoolVector<uint8_t>::Read r = image->get_data().read();
+		memcpy(pixels.data(), r.ptr(), pixels.size() * sizeof(uint32_t));
+	}
+	GdImageSurface(const GdImageSurface &surf) : surf_width(surf.surf_width), surf_height(surf.surf_height), pixels(surf.pixels), has_colorkey(surf.has_colorkey), colorkey(surf.colorkey), palette(surf.palette) { }
 };
 
 struct GdTextureSurface : public GdSurfaceImpl {
+	GD_POOLED(GdTextureSurface)
+
 	Ref<Texture> texture;
 	real_t surf_alpha;
+	std::unique_ptr<GdImageSurface> image; // pixels for blits into image surfaces
 
 	_FORCE_INLINE_ Type get_surface_type() const { return TEXTURE_SURFACE; }
 	_FORCE_INLINE_ int get_width() const { ERR_FAIL_NULL_V(texture, 1); return texture->get_width(); }
@@ -179,23 +1003,51 @@ struct GdTextureSurface : public GdSurfaceImpl {
 		texture = ResourceLoader::load(filename, "Texture");
 		surf_alpha = 1;
 	}
+
+	GdImageSurface *get_image() {
+		if (!image && texture.is_valid()) {
+			Ref<Image> data = texture->get_data();
+			if (AtlasTexture *atlas = Object::cast_to<AtlasTexture>(texture.ptr())) { // region of the atlas page
+				if (atlas->get_atlas().is_valid()) {
+					Ref<Image> page = atlas->get_atlas()->get_data();
+					data = page.is_valid() ? page->get_rect(atlas->get_region()) : Ref<Image>();
+				}
+			}
+			ERR_FAIL_NULL_V(data, nullptr);
+			image = std::make_unique<GdImageSurface>(data);
+		}
+		return image.get();
+	}
 };
 
 struct GdDisplaySurface : public GdSurfaceImpl {
+	GD_POOLED(GdDisplaySurface)
+
 	Object *instance = nullptr;
 
 	_FORCE_INLINE_ Type get_surface_type() const { return DISPLAY_SURFACE; }
 
+	// View size passed to the worker by the main thread with every tick
+	static _FORCE_INLINE_ const Size2 *&view_size() {
+		static thread_local const Size2 *_view_size = nullptr;
+		return _view_size;
+	}
+
+	_FORCE_INLINE_ Size2 get_view_size() const {
+		if (const Size2 *size = view_size()) {
+			return *size;
+		}
+		return instance->call("get_view_size");
+	}
+
 	_FORCE_INLINE_ int get_width() const {
 		ERR_FAIL_NULL_V(instance, 1);
-		Size2 size = instance->call("get_view_size");
-		return MAX(size.width, 1);
+		return MAX(get_view_size().width, 1);
 	}
 
 	_FORCE_INLINE_ int get_height() const {
 		ERR_FAIL_NULL_V(instance, 1);
-		Size2 size = instance->call("get_view_size");
-		return MAX(size.height, 1);
+		return MAX(get_view_size().height, 1);
 	}
 
 	_FORCE_INLINE_ std::unique_ptr<GdSurfaceImpl> clone() const { return std::make_unique<GdDisplaySurface>(instance); }
@@ -203,9 +1055,18 @@ struct GdDisplaySurface : public GdSurfaceImpl {
 	GdDisplaySurface(Object *instance) : instance(instance) { }
 	GdDisplaySurface(int instance_id) : instance(ObjectDB::get_instance(instance_id)) { }
 
+	// Commands issued from a thread with an active recorder are queued
+	// and replayed later on the main thread (see render_queue)
+	static _FORCE_INLINE_ GdRenderQueue *&recorder() {
+		static thread_local GdRenderQueue *_recorder = nullptr;
+		return _recorder;
+	}
+
 	_FORCE_INLINE_ void blit_texture(const Ref<Texture> &source, const Point2 &dest) {
 		ERR_FAIL_NULL(instance);
-		if (source.is_valid()) {
+		if (GdRenderQueue *queue = recorder()) {
+			queue->push(source, dest);
+		} else if (source.is_valid()) {
 			if (CanvasItem *canvas = Object::cast_to<CanvasItem>(instance)) {
 				canvas->draw_texture(source, dest);
 			} else {
@@ -216,7 +1077,9 @@ struct GdDisplaySurface : public GdSurfaceImpl {
 
 	_FORCE_INLINE_ void blit_texture(const Ref<Texture> &source, const Rect2 &area) {
 		ERR_FAIL_NULL(instance);
-		if (source.is_valid()) {
+		if (GdRenderQueue *queue = recorder()) {
+			queue->push(source, area);
+		} else if (source.is_valid()) {
 			if (CanvasItem *canvas = Object::cast_to<CanvasItem>(instance)) {
 				canvas->draw_texture_rect(source, area);
 			} else {
@@ -229,11 +1092,13 @@ struct GdDisplaySurface : public GdSurfaceImpl {
 		return blit_texture(source, Rect2(dest, area.size), area);
 	}
 
-	_FORCE_INLINE_ void blit_texture(const Ref<Texture> &source, const Rect2 &dest, const Rect2 &area) {
+	_FORCE_INLINE_ void blit_texture(const Ref<Texture> &source, const Rect2 &dest, const Rect2 &area, const Color &modulate = Color(1, 1, 1, 1)) {
 		ERR_FAIL_NULL(instance);
-		if (source.is_valid()) {
+		if (GdRenderQueue *queue = recorder()) {
+			queue->push(source, dest, area, modulate);
+		} else if (source.is_valid()) {
 			if (CanvasItem *canvas = Object::cast_to<CanvasItem>(instance)) {
-				canvas->draw_texture_rect_region(source, dest, area);
+				canvas->draw_texture_rect_region(source, dest, area, modulate);
 			} else {
 				WARN_PRINT("Not an CanvasItem");
 			}
@@ -242,9 +1107,11 @@ struct GdDisplaySurface : public GdSurfaceImpl {
 
 	_FORCE_INLINE_ void render_text(const Ref<Font> &font, const String &text, const Point2 &dest, const Color &color = Color(1, 1, 1, 1)) {
 		ERR_FAIL_NULL(instance);
-		if (font.is_valid()) {
+		if (GdRenderQueue *queue = recorder()) {
+			queue->push(font, text, dest, color);
+		} else if (font.is_valid()) {
 			if (CanvasItem *canvas = Object::cast_to<CanvasItem>(instance)) {
-				canvas->draw_string(font, dest + Vector2(0, font->get_ascent()), text, color);
+				_text_cache.get(font, text, color)->draw(canvas->get_canvas_item(), dest + Vector2(0, font->get_ascent()), color);
 			} else {
 				WARN_PRINT("Not an CanvasItem");
 			}
@@ -253,75 +1120,342 @@ struct GdDisplaySurface : public GdSurfaceImpl {
 
 	_FORCE_INLINE_ void render_rect(const Rect2 &dest, const Color &color = Color(1, 1, 1, 1)) {
 		ERR_FAIL_NULL(instance);
-		if (CanvasItem *canvas = Object::cast_to<CanvasItem>(instance)) {
+		if (GdRenderQueue *queue = recorder()) {
+			queue->push(dest, color);
+		} else if (CanvasItem *canvas = Object::cast_to<CanvasItem>(instance)) {
 			canvas->draw_rect(dest, color);
 		} else {
 			WARN_PRINT("Not an CanvasItem");
 		}
 	}
 
-	_FORCE_INLINE_ void render_queue(const std::vector<RenderLaterCmd> &queue) {
+	_FORCE_INLINE_ void render_style_box(const Ref<StyleBox> &style, const Rect2 &dest) {
+		ERR_FAIL_NULL(instance);
+		if (GdRenderQueue *queue = recorder()) {
+			queue->push(style, dest);
+		} else if (style.is_valid()) {
+			if (CanvasItem *canvas = Object::cast_to<CanvasItem>(instance)) {
+				canvas->draw_style_box(style, dest);
+			} else {
+				WARN_PRINT("Not an CanvasItem");
+			}
+		}
+	}
+
+	_FORCE_INLINE_ void render_outline_rect(const Rect2 &dest, const Color &color, real_t width) {
+		ERR_FAIL_NULL(instance);
+		if (GdRenderQueue *queue = recorder()) {
+			queue->push(dest, color, width);
+		} else if (CanvasItem *canvas = Object::cast_to<CanvasItem>(instance)) {
+			canvas->draw_rect(dest, color, false, width);
+		} else {
+			WARN_PRINT("Not an CanvasItem");
+		}
+	}
+
+	// Queue of a surface blitted at offset (commands are in surface coordinates)
+	void render_queue(const GdRenderQueue &queue, const Point2 &offset) {
+		if (offset == Point2()) {
+			render_queue(queue);
+			return;
+		}
+		GdRenderQueue moved;
+		moved.append(queue, offset);
+		render_queue(moved);
+	}
+
+	_FORCE_INLINE_ void render_queue(const GdRenderQueue &queue) {
+		if (GdRenderQueue *target = recorder()) {
+			target->append(queue);
+			return;
+		}
+		if (GdRenderBatcher::enabled()) {
+			if (CanvasItem *canvas = Object::cast_to<CanvasItem>(instance)) {
+				static GdRenderBatcher _batcher; // main thread only
+				_batcher.render(canvas->get_canvas_item(), queue);
+			} else {
+				WARN_PRINT("Not an CanvasItem");
+			}
+			return;
+		}
+		_render_stats.add(queue.size(), queue.size());
 		for (const auto &c : queue) {
 			switch(c.cmd) {
-				case RenderLaterCmd::BLIT_AT_POINT: blit_texture(c.texture, c.pt_dest); break;
-				case RenderLaterCmd::BLIT_TO_RECT: blit_texture(c.texture, c.rc_dest); break;
-				case RenderLaterCmd::BLIT_AREA_AT_POINT: blit_texture(c.texture, c.pt_dest, c.area); break;
-				case RenderLaterCmd::BLIT_AREA_TO_RECT: blit_texture(c.texture, c.rc_dest, c.area); break;
-				case RenderLaterCmd::BLIT_COLOR_RECT: render_rect(c.rc_dest, c.color); break;
-				case RenderLaterCmd::BLIT_TEXT: render_text(c.font, c.text, c.pt_dest, c.color); break;
+				case RenderLaterCmd::BLIT_AT_POINT: blit_texture(queue.texture(c), c.dest.position); break;
+				case RenderLaterCmd::BLIT_TO_RECT: blit_texture(queue.texture(c), c.dest); break;
+				case RenderLaterCmd::BLIT_AREA_AT_POINT: blit_texture(queue.texture(c), c.dest.position, c.area); break;
+				case RenderLaterCmd::BLIT_AREA_TO_RECT: blit_texture(queue.texture(c), c.dest, c.area, c.color); break;
+				case RenderLaterCmd::BLIT_COLOR_RECT: render_rect(c.dest, c.color); break;
+				case RenderLaterCmd::BLIT_OUTLINE_RECT: render_outline_rect(c.dest, c.color, c.area.position.x); break;
+				case RenderLaterCmd::BLIT_TEXT: render_text(queue.font(c), queue.text(c), c.dest.position, c.color); break;
+				case RenderLaterCmd::BLIT_STYLE_BOX: render_style_box(queue.style_box(c), c.dest); break;
+			}
+		}
+	}
+};
+
+// Retained drawing: commands recorded in gd_draw are split into layers, each
+// layer drawn to its own canvas item (child of the instance item). Layer is
+// re-emitted only when hash of its commands changes or is kept untouched when
+// the application calls display.keep_layer.
+struct GdRetainedCanvas {
+	struct Layer {
+		RID item;
+		uint32_t hash = 0;
+		bool keep = false;
+		GdRenderQueue commands;
+	};
+
+	std::map<int, Layer> layers;
+	RID parent;
+	GdRenderBatcher batcher;
+
+	static _FORCE_INLINE_ GdRetainedCanvas *&current() {
+		static thread_local GdRetainedCanvas *_current = nullptr;
+		return _current;
+	}
+
+	static uint32_t hash_commands(const GdRenderQueue &p_commands) {
+		uint32_t h = hash_djb2_one_32(p_commands.size());
+		for (const auto &c : p_commands) {
+			h = hash_djb2_one_32(c.cmd, h);
+			h = hash_djb2_one_64(uint64_t(p_commands.resource(c)), h);
+			h = hash_djb2_one_float(c.dest.position.x, h);
+			h = hash_djb2_one_float(c.dest.position.y, h);
+			h = hash_djb2_one_float(c.dest.size.x, h);
+			h = hash_djb2_one_float(c.dest.size.y, h);
+			h = hash_djb2_one_float(c.area.position.x, h);
+			h = hash_djb2_one_float(c.area.position.y, h);
+			h = hash_djb2_one_float(c.area.size.x, h);
+			h = hash_djb2_one_float(c.area.size.y, h);
+			h = hash_djb2_one_32(c.color.to_rgba32(), h);
+			if (c.text >= 0) {
+				h = hash_djb2_one_32(p_commands.text(c).hash(), h);
+			}
+		}
+		return h;
+	}
+
+	Layer &get_layer(int p_layer) {
+		Layer &layer = layers[p_layer];
+		if (!layer.item.is_valid()) {
+			VisualServer *vs = VisualServer::get_singleton();
+			layer.item = vs->canvas_item_create();
+			vs->canvas_item_set_parent(layer.item, parent);
+			vs->canvas_item_set_draw_index(layer.item, p_layer);
+		}
+		return layer;
+	}
+
+	void begin(const RID &p_parent) {
+		if (parent != p_parent) {
+			clear();
+			parent = p_parent;
+		}
+		for (auto &l : layers) {
+			l.second.commands.clear();
+			l.second.keep = false;
+		}
+		current() = this;
+		select(0);
+	}
+
+	void select(int p_layer) {
+		GdDisplaySurface::recorder() = &get_layer(p_layer).commands;
+	}
+
+	void keep(int p_layer) {
+		get_layer(p_layer).keep = true;
+	}
+
+	void end() {
+		GdDisplaySurface::recorder() = nullptr;
+		current() = nullptr;
+		int updated = 0, kept = 0;
+		for (auto &l : layers) {
+			Layer &layer = l.second;
+			if (layer.keep) {
+				kept++;
+				continue;
+			}
+			const uint32_t hash = hash_commands(layer.commands);
+			if (hash == layer.hash) {
+				kept++;
+				continue;
+			}
+			VisualServer::get_singleton()->canvas_item_clear(layer.item);
+			batcher.render(layer.item, layer.commands);
+			layer.hash = hash;
+			updated++;
+		}
+		_render_stats.add_layers(updated, kept);
+	}
+
+	void clear() {
+		for (auto &l : layers) {
+			if (l.second.item.is_valid()) {
+				VisualServer::get_singleton()->free(l.second.item);
 			}
 		}
+		layers.clear();
+		parent = RID();
 	}
+
+	~GdRetainedCanvas() { clear(); }
 };
 
 // Wrapper around Image/Texture/Sprite object
 
 struct _SurfaceStats {
-#ifdef DEBUG_ENABLED
 	bool _enabled = false;
 	int _create = 0;
 	int _destroy = 0;
 	uint64_t _frame = 0;
 	void enable() { _enabled = true; }
 	void disable() { _enabled = false; }
-	String _stats() const {
-		return vformat("(GdCPython) Surface stats: frame: %d, created: %d, deleted: %d", _frame, _create, _destroy);
-	}
+	String _stats() const;
 	void dump() const {
 		if (_enabled) {
 			print_verbose(_stats());
 		}
 	}
-	void next_frame() { _create = _destroy = 0; _frame++; }
+	void next_frame();
 	void new_surf() { _create++; }
 	void del_surf() { _destroy++; }
-#else
-	void enable() const { }
-	void disable() const { }
-	String _stats() const { return ""; }
-	void dump() const { }
-	void next_frame() const { }
-	void new_surf() const { }
-	void del_surf() const { }
-#endif
+	py::dict get_stats() const;
 } _surf_stats;
 
+// Shelf packing of rectangles into a square page (space is not reused)
+struct GdShelfPacker {
+	struct Shelf {
+		int y, height, x;
+	};
+
+	int size = 0;
+	std::vector<Shelf> shelves;
+	int next_y = 0;
+	int64_t used = 0; // pixels
+	int images = 0;
+
+	bool insert(int w, int h, Point2 &r_pos) {
+		Shelf *best = nullptr;
+		for (Shelf &shelf : shelves) {
+			if (shelf.height >= h && shelf.x + w <= size && (best == nullptr || shelf.height < best->height)) {
+				best = &shelf;
+			}
+		}
+		if (best == nullptr) {
+			if (next_y + h > size) {
+				return false;
+			}
+			shelves.push_back(Shelf{ next_y, h, 0 });
+			next_y += h;
+			best = &shelves.back();
+		}
+		r_pos = Point2(best->x, best->y);
+		best->x += w;
+		used += w * h;
+		images++;
+		return true;
+	}
+};
+
+// Baked labels share viewport pages: label is drawn to the page canvas at a
+// free shelf position and blitted as a region of the page texture. Only the
+// last MAX_PAGES pages take new labels, older pages are kept alive by the
+// labels still using them (cache entries and surfaces).
+struct GdLabelBaker {
+	static const int PAGE_SIZE = 1024;
+	static const int MAX_PAGES = 4;
+	static const int PADDING = 1;
+
+	struct Page : GdShelfPacker {
+		Ref<GdBakedTexture> target;
+	};
+
+	std::deque<Page> pages;
+
+	// Region with the label, null if it is larger than a page
+	Ref<Texture> bake(const GdTextCache::Entry &p_label) {
+		const int w = Math::ceil(p_label.size.width) + 2 * PADDING, h = Math::ceil(p_label.size.height) + 2 * PADDING;
+		if (w > PAGE_SIZE || h > PAGE_SIZE) {
+			return Ref<Texture>();
+		}
+		Point2 pos;
+		Page *page = nullptr;
+		for (Page &p : pages) {
+			if (p.insert(w, h, pos)) {
+				page = &p;
+				break;
+			}
+		}
+		if (page == nullptr) {
+			if (int(pages.size()) >= MAX_PAGES) {
+				pages.pop_front();
+			}
+			pages.push_back(Page());
+			page = &pages.back();
+			page->size = PAGE_SIZE;
+			page->target = Ref<GdBakedTexture>(memnew(GdBakedTexture(PAGE_SIZE, PAGE_SIZE)));
+			page->insert(w, h, pos);
+		}
+		pos += Point2(PADDING, PADDING);
+		p_label.draw(page->target->get_canvas_item(), pos + Point2(0, p_label.font->get_ascent()), p_label.color);
+		page->target->redraw();
+		Ref<AtlasTexture> region;
+		region.instance();
+		region->set_atlas(page->target);
+		region->set_region(Rect2(pos, p_label.size));
+		return region;
+	}
+
+	// Baked content is available after the page was drawn
+	static _FORCE_INLINE_ bool is_ready(const Ref<Texture> &p_baked) {
+		const Texture *texture = p_baked.ptr();
+		if (const AtlasTexture *region = Object::cast_to<AtlasTexture>(texture)) {
+			texture = region->get_atlas().ptr();
+		}
+		const GdBakedTexture *baked = Object::cast_to<GdBakedTexture>(texture);
+		return baked && baked->is_ready();
+	}
+
+	void clear() { pages.clear(); }
+} _label_baker;
+
 struct GdSurface {
+	GD_POOLED(GdSurface)
+
 	std::unique_ptr<GdSurfaceImpl> impl;
-	std::vector<RenderLaterCmd> _render_later;
+	GdRenderQueue _render_later; // shared with copies until modified
+	Ref<Texture> _baked; // valid until new commands are queued (label page region for text)
+	int _blits_unchanged = 0;
+
+	// Surfaces with at least AUTO_BAKE_COMMANDS queued commands are baked
+	// after being blitted AUTO_BAKE_BLITS times without a change
+	static const int AUTO_BAKE_COMMANDS = 16;
+	static const int AUTO_BAKE_BLITS = 3;
+
+	static _FORCE_INLINE_ bool &auto_bake() {
+		static bool _auto_bake = true;
+		return _auto_bake;
+	}
 
 	_FORCE_INLINE_ GdSurfaceImpl::Type get_surface_type() const { return impl->get_surface_type(); }
 	_FORCE_INLINE_ GdDisplaySurface *get_as_display() const { return (GdDisplaySurface*)impl.get(); }
 	_FORCE_INLINE_ GdColorSurface *get_as_color() const { return (GdColorSurface*)impl.get(); }
 	_FORCE_INLINE_ GdTextureSurface *get_as_texture() const { return (GdTextureSurface*)impl.get(); }
 	_FORCE_INLINE_ GdTextSurface *get_as_text() const { return (GdTextSurface*)impl.get(); }
+	_FORCE_INLINE_ GdImageSurface *get_as_image() const { return (GdImageSurface*)impl.get(); }
 
-	GdSurface(const GdSurface &surf) :  impl(surf.impl->clone()), _render_later(surf._render_later) { _surf_stats.new_surf(); }
+	GdSurface(const GdSurface &surf) :  impl(surf.impl->clone()), _render_later(surf._render_later), _baked(surf._baked) { _surf_stats.new_surf(); }
+	// temporaries returned to Python (e.g. Font.render) are moved, not cloned
+	GdSurface(GdSurface &&surf) : impl(std::move(surf.impl)), _render_later(std::move(surf._render_later)), _baked(surf._baked) { _surf_stats.new_surf(); }
 	GdSurface(int surf_width, int surf_height) : impl(std::make_unique<GdColorSurface>(surf_width, surf_height)) { _surf_stats.new_surf(); }
 	GdSurface(const std::vector<real_t> surf_size) : impl(std::make_unique<GdColorSurface>(surf_size[0], surf_size[1])) { _surf_stats.new_surf(); }
 	GdSurface(const Ref<Font> &font, const String &text, const Color &color) : impl(std::make_unique<GdTextSurface>(font, text, color)) { _surf_stats.new_surf(); }
 	GdSurface(const String &filename) : impl(std::make_unique<GdTextureSurface>(filename)) { _surf_stats.new_surf(); }
 	GdSurface(int &instance_id) : impl(std::make_unique<GdDisplaySurface>(instance_id)) { _surf_stats.new_surf(); }
+	GdSurface(std::unique_ptr<GdSurfaceImpl> &&surf_impl) : impl(std::move(surf_impl)) { _surf_stats.new_surf(); }
 
 	~GdSurface() { _surf_stats.del_surf(); }
 
@@ -332,6 +1466,210 @@ struct GdSurface {
 	void fill(const std::vector<uint8_t> &color) {
 		if (impl->get_surface_type() == GdSurfaceImpl::COLOR_SURFACE) {
 			get_as_color()->surf_color = std::make_unique<Color>(vec_to_color(color));
+			_invalidate();
+		} else if (impl->get_surface_type() == GdSurfaceImpl::IMAGE_SURFACE) {
+			get_as_image()->fill(vec_to_color(color), 0, 0, get_width(), get_height());
+		}
+	}
+
+	void fill(const std::vector<uint8_t> &color, const std::vector<real_t> &rect) {
+		ERR_FAIL_COND(rect.size() != 4);
+		ERR_FAIL_COND(impl->get_surface_type() != GdSurfaceImpl::IMAGE_SURFACE);
+		get_as_image()->fill(vec_to_color(color), rect[0], rect[1], rect[2], rect[3]);
+	}
+
+	// Pixel access (image surfaces)
+	_FORCE_INLINE_ std::vector<uint8_t> get_at(const std::vector<int> &pos) const {
+		ERR_FAIL_COND_V(pos.size() != 2, std::vector<uint8_t>());
+		ERR_FAIL_COND_V(impl->get_surface_type() != GdSurfaceImpl::IMAGE_SURFACE, std::vector<uint8_t>());
+		const uint32_t p = GdImageSurface::pack(get_as_image()->get_at(pos[0], pos[1]));
+		return { uint8_t(p), uint8_t(p >> 8), uint8_t(p >> 16), uint8_t(p >> 24) };
+	}
+
+	_FORCE_INLINE_ void set_at(const std::vector<int> &pos, const std::vector<uint8_t> &color) {
+		ERR_FAIL_COND(pos.size() != 2);
+		ERR_FAIL_COND(impl->get_surface_type() != GdSurfaceImpl::IMAGE_SURFACE);
+		get_as_image()->set_at(pos[0], pos[1], vec_to_color(color));
+	}
+
+	void set_colorkey(const py::object &color) {
+		ERR_FAIL_COND(impl->get_surface_type() != GdSurfaceImpl::IMAGE_SURFACE);
+		GdImageSurface *surf = get_as_image();
+		surf->has_colorkey = !color.is_none();
+		surf->colorkey = surf->has_colorkey ? GdImageSurface::pack(vec_to_color(color.cast<std::vector<uint8_t>>())) : 0;
+	}
+
+	py::object get_colorkey() const {
+		ERR_FAIL_COND_V(impl->get_surface_type() != GdSurfaceImpl::IMAGE_SURFACE, py::none());
+		const GdImageSurface *surf = get_as_image();
+		if (!surf->has_colorkey) {
+			return py::none();
+		}
+		const uint32_t p = surf->colorkey;
+		return py::make_tuple(uint8_t(p), uint8_t(p >> 8), uint8_t(p >> 16), uint8_t(p >> 24));
+	}
+
+	void set_palette(const std::vector<std::vector<uint8_t>> &colors) {
+		ERR_FAIL_COND(impl->get_surface_type() != GdSurfaceImpl::IMAGE_SURFACE);
+		ERR_FAIL_COND(colors.size() > 256);
+		GdImageSurface *surf = get_as_image();
+		surf->palette.clear();
+		for (const auto &c : colors) {
+			surf->palette.push_back(GdImageSurface::pack(vec_to_color(c)));
+		}
+	}
+
+	// Buffer of 8-bit palette indices (rect.w x rect.h) written to the rect
+	void blit_indices(const py::object &buffer, const std::vector<real_t> &rect) {
+		ERR_FAIL_COND(rect.size() != 4);
+		ERR_FAIL_COND(impl->get_surface_type() != GdSurfaceImpl::IMAGE_SURFACE);
+		GdBufferView indices(buffer);
+		const int w = rect[2], h = rect[3];
+		if (!indices.is_bytes() || indices.len < Py_ssize_t(w) * h) {
+			throw py::value_error("Buffer of width * height bytes is expected");
+		}
+		get_as_image()->set_indices((const uint8_t *)indices.ptr, w, rect[0], rect[1], w, h);
+	}
+
+	_FORCE_INLINE_ void _invalidate() {
+		_baked.unref();
+		_blits_unchanged = 0;
+	}
+
+	template <typename... Args>
+	_FORCE_INLINE_ void _queue(const Args &...args) {
+		_render_later.push(args...);
+		_invalidate();
+	}
+
+	_FORCE_INLINE_ bool is_baked() const { return _baked.is_valid(); }
+
+	// Pixel buffer view released by Python (see def_buffer)
+	_FORCE_INLINE_ void release_buffer() {
+		if (impl && impl->get_surface_type() == GdSurfaceImpl::IMAGE_SURFACE) {
+			get_as_image()->views--;
+		}
+	}
+
+	// Render surface content and queued commands into an offscreen texture
+	bool bake() {
+		ERR_FAIL_NULL_V(impl, false);
+		ERR_FAIL_COND_V_MSG(Thread::get_caller_id() != Thread::get_main_id(), false, "Surface can be baked only on the main thread.");
+		if (_baked.is_valid()) {
+			return true;
+		}
+		Ref<GdBakedTexture> baked;
+		switch (impl->get_surface_type()) {
+			case GdSurfaceImpl::TEXTURE_SURFACE: {
+				GdTextureSurface *surf = get_as_texture();
+				ERR_FAIL_NULL_V(surf->texture, false);
+				baked = Ref<GdBakedTexture>(memnew(GdBakedTexture(get_width(), get_height())));
+				surf->texture->draw(baked->get_canvas_item(), Point2());
+			} break;
+			case GdSurfaceImpl::COLOR_SURFACE: {
+				GdColorSurface *surf = get_as_color();
+				baked = Ref<GdBakedTexture>(memnew(GdBakedTexture(get_width(), get_height())));
+				if (surf->surf_color) {
+					VisualServer::get_singleton()->canvas_item_add_rect(baked->get_canvas_item(), Rect2(0, 0, get_width(), get_height()), *surf->surf_color);
+				}
+			} break;
+			case GdSurfaceImpl::TEXT_SURFACE: {
+				// static labels: region is shared by all surfaces with the same text
+				GdTextSurface *surf = get_as_text();
+				ERR_FAIL_COND_V(!surf->shaped, false);
+				if (surf->shaped->baked.is_null()) {
+					surf->shaped->baked = _label_baker.bake(*surf->shaped);
+				}
+				if (surf->shaped->baked.is_null()) { // larger than a label page
+					baked = Ref<GdBakedTexture>(memnew(GdBakedTexture(surf->text_size.width, surf->text_size.height)));
+					surf->shaped->draw(baked->get_canvas_item(), Point2(0, surf->font->get_ascent()), surf->color);
+					surf->shaped->baked = baked;
+				}
+				_baked = surf->shaped->baked;
+				return true;
+			}
+			default: {
+				WARN_PRINT("Not supported");
+				return false;
+			}
+		}
+		GdRenderBatcher batcher;
+		batcher.render(baked->get_canvas_item(), _render_later);
+		_baked = baked;
+		return true;
+	}
+
+	// Baked texture to be blitted instead of replaying the queue. Replay is
+	// moved to the blit position but not scaled or clipped to an area, so
+	// only plain blits at a point are baked automatically.
+	_FORCE_INLINE_ bool _use_baked(bool p_auto) {
+		if (_baked.is_valid()) {
+			return GdLabelBaker::is_ready(_baked);
+		}
+		if (p_auto && auto_bake() && int(_render_later.size()) >= AUTO_BAKE_COMMANDS && ++_blits_unchanged >= AUTO_BAKE_BLITS) {
+			if (Thread::get_caller_id() == Thread::get_main_id()) {
+				bake();
+			}
+		}
+		return false;
+	}
+
+	// Blits from or into image surfaces
+	void _blit_image(GdSurface &source, const std::vector<real_t> &dest, const Rect2 *area) {
+		const GdSurfaceImpl::Type source_type = source.impl->get_surface_type();
+		if (impl->get_surface_type() == GdSurfaceImpl::IMAGE_SURFACE) {
+			GdImageSurface *surf = get_as_image();
+			switch (source_type) {
+				case GdSurfaceImpl::IMAGE_SURFACE:
+				case GdSurfaceImpl::TEXTURE_SURFACE: {
+					GdImageSurface *src = source_type == GdSurfaceImpl::IMAGE_SURFACE ? source.get_as_image() : source.get_as_texture()->get_image();
+					ERR_FAIL_NULL(src);
+					const Rect2 a = area ? *area : Rect2(0, 0, src->get_width(), src->get_height());
+					int w = a.size.width, h = a.size.height;
+					if (dest.size() == 4) {
+						w = MIN(w, int(dest[2]));
+						h = MIN(h, int(dest[3]));
+					}
+					surf->blit(*src, dest[0], dest[1], a.position.x, a.position.y, w, h);
+				} break;
+				case GdSurfaceImpl::COLOR_SURFACE: {
+					GdColorSurface *src = source.get_as_color();
+					if (src->surf_color) {
+						const Size2 size = dest.size() == 4 ? Size2(dest[2], dest[3]) : (area ? area->size : source.get_size());
+						surf->blend(*src->surf_color, dest[0], dest[1], size.width, size.height);
+					}
+				} break;
+				default: {
+					WARN_PRINT("Not supported");
+				} break;
+			}
+			return;
+		}
+		// image surface drawn as a texture (queued blits get a copy of the pixels)
+		GdImageSurface *image = source.get_as_image();
+		const Ref<Texture> texture = impl->get_surface_type() == GdSurfaceImpl::DISPLAY_SURFACE ? image->get_texture() : image->snapshot();
+		const Point2 pos(dest[0], dest[1]);
+		const Rect2 rect = dest.size() == 4 ? Rect2(dest[0], dest[1], dest[2], dest[3]) : Rect2();
+		switch (impl->get_surface_type()) {
+			case GdSurfaceImpl::DISPLAY_SURFACE: {
+				GdDisplaySurface *disp = get_as_display();
+				if (area) {
+					dest.size() == 2 ? disp->blit_texture(texture, pos, *area) : disp->blit_texture(texture, rect, *area);
+				} else {
+					dest.size() == 2 ? disp->blit_texture(texture, pos) : disp->blit_texture(texture, rect);
+				}
+			} break;
+			case GdSurfaceImpl::TEXTURE_SURFACE:
+			case GdSurfaceImpl::COLOR_SURFACE: {
+				if (area) {
+					dest.size() == 2 ? _queue(texture, pos, *area) : _queue(texture, rect, *area);
+				} else {
+					dest.size() == 2 ? _queue(texture, pos) : _queue(texture, rect);
+				}
+			} break;
+			default: {
+				WARN_PRINT("Not supported");
+			} break;
 		}
 	}
 
@@ -347,9 +1685,14 @@ struct GdSurface {
 		ERR_FAIL_NULL(impl);
 		ERR_FAIL_NULL(source.impl);
 		ERR_FAIL_COND(dest.size() != 2 && dest.size() != 4);
+		if (impl->get_surface_type() == GdSurfaceImpl::IMAGE_SURFACE || source.impl->get_surface_type() == GdSurfaceImpl::IMAGE_SURFACE) {
+			_blit_image(source, dest, nullptr);
+			return;
+		}
 		switch(impl->get_surface_type()) {
 			case GdSurfaceImpl::TEXTURE_SURFACE: {
 				switch(source.impl->get_surface_type()) {
+					case GdSurfaceImpl::IMAGE_SURFACE: // see _blit_image
 					case GdSurfaceImpl::DISPLAY_SURFACE: {
 						WARN_PRINT("Not supported");
 					} break;
@@ -357,21 +1700,21 @@ struct GdSurface {
 						GdColorSurface *surf = source.get_as_color();
 						if (surf->surf_color) {
 							switch (dest.size()) {
-								case 2: _render_later.push_back(RenderLaterCmd(
-									Rect2(Point2(dest[0], dest[1]), Size2(surf->get_width(), surf->get_height())), *surf->surf_color)); break;
-								case 4: _render_later.push_back(RenderLaterCmd(Rect2(dest[0], dest[1], dest[2], dest[3]), *surf->surf_color)); break;
+								case 2: _queue(
+									Rect2(Point2(dest[0], dest[1]), Size2(surf->get_width(), surf->get_height())), *surf->surf_color); break;
+								case 4: _queue(Rect2(dest[0], dest[1], dest[2], dest[3]), *surf->surf_color); break;
 							}
 						}
 					} break;
 					case GdSurfaceImpl::TEXT_SURFACE: {
 						GdTextSurface *surf = source.get_as_text();
-						_render_later.push_back(RenderLaterCmd(surf->font, surf->text, Point2(dest[0], dest[1]), surf->color));
+						_queue(surf->font, surf->text, Point2(dest[0], dest[1]), surf->color);
 					}
 					case GdSurfaceImpl::TEXTURE_SURFACE: {
 						GdTextureSurface *surf = source.get_as_texture();
 						switch (dest.size()) {
-							case 2: _render_later.push_back(RenderLaterCmd(surf->texture, Point2(dest[0], dest[1]))); break;
-							case 4: _render_later.push_back(RenderLaterCmd(surf->texture, Rect2(dest[0], dest[1], dest[2], dest[3]))); break;
+							case 2: _queue(surf->texture, Point2(dest[0], dest[1])); break;
+							case 4: _queue(surf->texture, Rect2(dest[0], dest[1], dest[2], dest[3])); break;
 						}
 					} break;
 				}
@@ -381,8 +1724,8 @@ struct GdSurface {
 					case GdSurfaceImpl::TEXTURE_SURFACE: {
 						GdTextureSurface *surf = source.get_as_texture();
 						switch (dest.size()) {
-							case 2: _render_later.push_back(RenderLaterCmd(surf->texture, Point2(dest[0], dest[1]))); break;
-							case 4: _render_later.push_back(RenderLaterCmd(surf->texture, Rect2(dest[0], dest[1], dest[2], dest[3]))); break;
+							case 2: _queue(surf->texture, Point2(dest[0], dest[1])); break;
+							case 4: _queue(surf->texture, Rect2(dest[0], dest[1], dest[2], dest[3])); break;
 						}
 					} break;
 					default: {
@@ -390,18 +1733,28 @@ struct GdSurface {
 					} break;
 				}
 			} break;
-			case GdSurfaceImpl::TEXT_SURFACE: {
+			case GdSurfaceImpl::TEXT_SURFACE:
+			case GdSurfaceImpl::IMAGE_SURFACE: { // see _blit_image
 			} break;
 			case GdSurfaceImpl::DISPLAY_SURFACE: {
 				GdDisplaySurface *disp = get_as_display();
+				if (source._use_baked(dest.size() == 2)) {
+					switch (dest.size()) {
+						case 2: disp->blit_texture(source._baked, Point2(dest[0], dest[1])); break;
+						case 4: disp->blit_texture(source._baked, Rect2(dest[0], dest[1], dest[2], dest[3])); break;
+					}
+					break;
+				}
 				switch(source.impl->get_surface_type()) {
+					case GdSurfaceImpl::IMAGE_SURFACE: // see _blit_image
 					case GdSurfaceImpl::DISPLAY_SURFACE: {
 					} break;
 					case GdSurfaceImpl::COLOR_SURFACE: {
-						if (dest.size() == 4) {
-							GdColorSurface *surf = source.get_as_color();
-							if (surf->surf_color) {
-								disp->render_rect(Rect2(dest[0], dest[1], dest[2], dest[3]), *surf->surf_color);
+						GdColorSurface *surf = source.get_as_color();
+						if (surf->surf_color) {
+							switch (dest.size()) {
+								case 2: disp->render_rect(Rect2(Point2(dest[0], dest[1]), source.get_size()), *surf->surf_color); break;
+								case 4: disp->render_rect(Rect2(dest[0], dest[1], dest[2], dest[3]), *surf->surf_color); break;
 							}
 						}
 					} break;
@@ -418,7 +1771,7 @@ struct GdSurface {
 					} break;
 				}
 				if (source._render_later.size()) {
-					disp->render_queue(source._render_later);
+					disp->render_queue(source._render_later, Point2(dest[0], dest[1]));
 				}
 			} break;
 		}
@@ -428,22 +1781,26 @@ struct GdSurface {
 		ERR_FAIL_NULL(impl);
 		ERR_FAIL_NULL(source.impl);
 		ERR_FAIL_COND(dest.size() != 2 && dest.size() != 4);
+		if (impl->get_surface_type() == GdSurfaceImpl::IMAGE_SURFACE || source.impl->get_surface_type() == GdSurfaceImpl::IMAGE_SURFACE) {
+			_blit_image(source, dest, &area);
+			return;
+		}
 		switch(impl->get_surface_type()) {
 			case GdSurfaceImpl::TEXTURE_SURFACE: {
 				switch(source.impl->get_surface_type()) {
 					case GdSurfaceImpl::TEXTURE_SURFACE: {
 						GdTextureSurface *surf = source.get_as_texture();
 						switch (dest.size()) {
-							case 2: _render_later.push_back(RenderLaterCmd(surf->texture, Point2(dest[0], dest[1]), area)); break;
-							case 4: _render_later.push_back(RenderLaterCmd(surf->texture, Rect2(dest[0], dest[1], dest[2], dest[3]), area)); break;
+							case 2: _queue(surf->texture, Point2(dest[0], dest[1]), area); break;
+							case 4: _queue(surf->texture, Rect2(dest[0], dest[1], dest[2], dest[3]), area); break;
 						}
 					} break;
 					case GdSurfaceImpl::COLOR_SURFACE: {
 						GdColorSurface *surf = source.get_as_color();
 						if (surf->surf_color) {
 							switch (dest.size()) {
-								case 2: _render_later.push_back(RenderLaterCmd(area, *surf->surf_color)); break;
-								case 4: _render_later.push_back(RenderLaterCmd(area, *surf->surf_color)); break;
+								case 2: _queue(area, *surf->surf_color); break;
+								case 4: _queue(area, *surf->surf_color); break;
 							}
 						}
 					} break;
@@ -457,8 +1814,8 @@ struct GdSurface {
 					case GdSurfaceImpl::TEXTURE_SURFACE: {
 						GdTextureSurface *surf = source.get_as_texture();
 						switch (dest.size()) {
-							case 2: _render_later.push_back(RenderLaterCmd(surf->texture, Point2(dest[0], dest[1]), area)); break;
-							case 4: _render_later.push_back(RenderLaterCmd(surf->texture, Rect2(dest[0], dest[1], dest[2], dest[3]), area)); break;
+							case 2: _queue(surf->texture, Point2(dest[0], dest[1]), area); break;
+							case 4: _queue(surf->texture, Rect2(dest[0], dest[1], dest[2], dest[3]), area); break;
 						}
 					} break;
 					default: {
@@ -466,11 +1823,20 @@ struct GdSurface {
 					} break;
 				}
 			} break;
-			case GdSurfaceImpl::TEXT_SURFACE: {
+			case GdSurfaceImpl::TEXT_SURFACE:
+			case GdSurfaceImpl::IMAGE_SURFACE: { // see _blit_image
 			} break;
 			case GdSurfaceImpl::DISPLAY_SURFACE: {
 				GdDisplaySurface *disp = get_as_display();
+				if (source._use_baked(false)) {
+					switch (dest.size()) {
+						case 2: disp->blit_texture(source._baked, Point2(dest[0], dest[1]), area); break;
+						case 4: disp->blit_texture(source._baked, Rect2(dest[0], dest[1], dest[2], dest[3]), area); break;
+					}
+					break;
+				}
 				switch(source.impl->get_surface_type()) {
+					case GdSurfaceImpl::IMAGE_SURFACE: // see _blit_image
 					case GdSurfaceImpl::DISPLAY_SURFACE: {
 						WARN_PRINT("Not supported");
 					} break;
@@ -489,23 +1855,54 @@ struct GdSurface {
 					} break;
 				}
 				if (source._render_later.size()) {
-					disp->render_queue(source._render_later);
+					disp->render_queue(source._render_later, Point2(dest[0], dest[1]) - area.position);
 				}
 			} break;
 		}
 	}
 };
 
+String _SurfaceStats::_stats() const {
+	GdPool<GdSurface> &pool = GdPool<GdSurface>::get();
+	return vformat("(GdCPython) Surface stats: frame: %d, created: %d, deleted: %d, heap: %d, reused: %d", _frame, _create, _destroy, pool.allocated, pool.reused);
+}
+
+void _SurfaceStats::next_frame() {
+	_create = _destroy = 0;
+	_frame++;
+	GdPool<GdSurface>::get().trim();
+	GdPool<GdColorSurface>::get().trim();
+	GdPool<GdTextSurface>::get().trim();
+	GdPool<GdTextureSurface>::get().trim();
+	GdPool<GdDisplaySurface>::get().trim();
+	GdPool<GdImageSurface>::get().trim();
+}
+
+py::dict _SurfaceStats::get_stats() const {
+	return py::dict(
+			py::arg("frame") = _frame,
+			py::arg("created") = _create,
+			py::arg("deleted") = _destroy,
+			py::arg("surface") = GdPool<GdSurface>::get().get_stats(),
+			py::arg("color") = GdPool<GdColorSurface>::get().get_stats(),
+			py::arg("text") = GdPool<GdTextSurface>::get().get_stats(),
+			py::arg("texture") = GdPool<GdTextureSurface>::get().get_stats(),
+			py::arg("display") = GdPool<GdDisplaySurface>::get().get_stats(),
+			py::arg("image") = GdPool<GdImageSurface>::get().get_stats());
+}
+
 // Wrapper around Bitmap or Dynamic font
 struct GdFont {
 	Ref<Font> font;
 
+	GdFont() { }
 	GdFont(const std::string &path, int size) { load(path, size); }
 	GdFont(const std::string &path, int size, int stretch) { load(path, size, 0, Color(), stretch); }
 	GdFont(const std::string &path, int size, int outline_size, Color outline_color) { load(path, size, outline_size, outline_color); }
 	GdFont(const std::string &path, int size, int outline_size, const std::vector<uint8_t>& outline_color) { load(path, size, outline_size, vec_to_color(outline_color)); }
 
 	bool load(const std::string &path, int size, int outline_size = 0, Color outline_color = Color(), int stretch = 0);
+	bool _load(const std::string &path, int size, int outline_size, Color outline_color, int stretch);
 
 	_FORCE_INLINE_ GdSurface render(const std::string &text, bool alias, int color) {
 		return GdSurface(font, String(text.c_str()), Color::hex(color));
@@ -515,7 +1912,7 @@ struct GdFont {
 		return GdSurface(font, String(text.c_str()), vec_to_color(color));
 	}
 
-	_FORCE_INLINE_ Size2 size(const std::string &text) const { return font->get_string_size(String(text.c_str())); }
+	_FORCE_INLINE_ Size2 size(const std::string &text) const { ERR_FAIL_NULL_V(font, Size2()); return _text_cache.get(font, String(text.c_str()), Color(1, 1, 1, 1))->size; }
 	_FORCE_INLINE_ int get_height() const { return font->get_height(); }
 };
 
@@ -549,6 +1946,585 @@ struct GdEvent {
 	};
 };
 
+// Packed event record (layout matches GdEventBuffer::RECORD_FORMAT)
+struct GdEventRecord {
+	int32_t type;
+	float x, y;
+	int32_t button;
+	int32_t key;
+	uint32_t unicode;
+
+	_FORCE_INLINE_ GdEvent to_event() const {
+		GdEvent ev{type};
+		switch (type) {
+			case GdEvent::KEYDOWN:
+			case GdEvent::KEYUP: {
+				ev.key = key;
+				ev.unicode = unicode;
+			} break;
+			default: {
+				ev.position = Point2(x, y);
+				ev.button = button;
+			}
+		}
+		return ev;
+	}
+};
+
+static_assert(sizeof(GdEventRecord) == 24, "Unexpected GdEventRecord layout");
+
+// Events collected during one frame and delivered to Python at once
+struct GdEventBuffer {
+	static constexpr const char *RECORD_FORMAT = "=iffiiI";
+
+	std::vector<GdEventRecord> records;
+	uint64_t frame = 0;
+	int coalesced = 0;
+	int views = 0; // buffers exported to Python
+	bool shared = false; // records storage is exported
+	std::vector<std::vector<GdEventRecord>> retired; // exported storage, kept until released
+
+	// Exported storage is never modified: it is retired and records continue
+	// in a new vector (a copy when p_keep is set)
+	_FORCE_INLINE_ void _detach(bool p_keep) {
+		if (shared) {
+			retired.push_back(std::vector<GdEventRecord>());
+			retired.back().swap(records);
+			if (p_keep) {
+				records = retired.back();
+			} else {
+				records.reserve(retired.back().capacity());
+			}
+			shared = false;
+		}
+	}
+
+	_FORCE_INLINE_ const GdEventRecord *export_records() {
+		views++;
+		shared = true;
+		return records.data();
+	}
+
+	_FORCE_INLINE_ void release_buffer() {
+		if (--views == 0) {
+			retired.clear();
+			shared = false;
+		}
+	}
+
+	_FORCE_INLINE_ void push(const GdEventRecord &ev, bool coalesce_motion) {
+		_detach(true);
+		if (coalesce_motion && ev.type == GdEvent::MOUSEMOTION && !records.empty() && records.back().type == GdEvent::MOUSEMOTION) {
+			records.back() = ev; // keep the most recent position only
+			coalesced++;
+		} else {
+			records.push_back(ev);
+		}
+	}
+
+	_FORCE_INLINE_ void clear() { _detach(false); records.clear(); coalesced = 0; frame++; } // keeps capacity
+
+	// Records moved from another buffer (storage is swapped)
+	_FORCE_INLINE_ void take(GdEventBuffer &p_from) {
+		_detach(false);
+		records.swap(p_from.records);
+		p_from.clear();
+	}
+	_FORCE_INLINE_ size_t size() const { return records.size(); }
+	_FORCE_INLINE_ bool empty() const { return records.empty(); }
+
+	_FORCE_INLINE_ const GdEventRecord &at(int index) const {
+		static GdEventRecord _empty{GdEvent::QUIT};
+		ERR_FAIL_INDEX_V(index, int(records.size()), _empty);
+		return records[index];
+	}
+};
+
+// Value yielded by a coroutine to suspend it
+struct GdWait {
+	enum {
+		FRAMES,
+		SECONDS,
+		SIGNAL,
+	};
+	int type;
+	int frames;
+	real_t seconds;
+	int instance_id;
+	std::string signal;
+};
+
+// Resource loaded in background by GdAsyncLoader. State is shared with the
+// loader thread, the Python object is finished on the calling thread.
+struct GdLoadFuture {
+	enum {
+		PENDING,
+		LOADING,
+		DONE,
+		FAILED,
+	};
+	enum Kind {
+		IMAGE,
+		FONT,
+	};
+
+	struct State {
+		String path, type_hint;
+		std::atomic<int> status{ PENDING };
+		std::atomic<int> stage{ 0 }, stage_count{ 0 };
+		std::atomic<bool> cancelled{ false };
+		Ref<Resource> resource; // written by the loader before status is set
+		std::mutex mutex;
+		std::condition_variable cond;
+
+		_FORCE_INLINE_ bool is_finished() const { return status.load() >= DONE; }
+	};
+
+	std::shared_ptr<State> state;
+	Kind kind;
+	std::string path;
+	int size = 0, outline_size = 0, stretch = 0; // font parameters
+	Color outline_color;
+	py::object value; // finished result
+
+	_FORCE_INLINE_ bool done() const { return state->is_finished(); }
+	_FORCE_INLINE_ bool failed() const { return state->status.load() == FAILED; }
+	_FORCE_INLINE_ int status() const { return state->status.load(); }
+	_FORCE_INLINE_ real_t progress() const {
+		if (done()) {
+			return 1;
+		}
+		const int count = state->stage_count.load();
+		return count > 0 ? CLAMP(real_t(state->stage.load()) / count, real_t(0), real_t(1)) : 0;
+	}
+	_FORCE_INLINE_ void cancel() { state->cancelled = true; }
+
+	// Blocks until loaded (GIL is released while waiting). With the default
+	// (single-safe) thread model the loader thread waits for the main thread
+	// to run its VisualServer calls, so on the main thread the wait is polled
+	// and the server command queue is flushed in between.
+	bool wait(real_t timeout) {
+		if (done()) {
+			return true;
+		}
+		const bool main_thread = Thread::get_caller_id() == Thread::get_main_id();
+		const uint64_t until = OS::get_singleton()->get_ticks_usec() + uint64_t(MAX(timeout, real_t(0)) * 1000000);
+		py::gil_scoped_release release;
+		std::unique_lock<std::mutex> lock(state->mutex);
+		auto finished = [this]() { return state->is_finished(); };
+		if (!main_thread) {
+			if (timeout < 0) {
+				state->cond.wait(lock, finished);
+				return true;
+			}
+			return state->cond.wait_for(lock, std::chrono::microseconds(int64_t(timeout * 1000000)), finished);
+		}
+		while (!finished()) {
+			if (timeout >= 0 && OS::get_singleton()->get_ticks_usec() >= until) {
+				return false;
+			}
+			lock.unlock();
+			VisualServer::get_singleton()->sync(); // runs calls queued by the loader thread
+			lock.lock();
+			state->cond.wait_for(lock, std::chrono::milliseconds(1), finished);
+		}
+		return true;
+	}
+
+	py::object result(); // Surface or Font
+};
+
+// Single background thread polling ResourceInteractiveLoader for queued
+// futures. With the default (single-safe) thread model VisualServer calls
+// made there (texture_create) are queued and wait for the main thread to
+// flush them, so the main thread must not block on a future without
+// flushing (see GdLoadFuture::wait).
+struct GdAsyncLoader {
+	std::deque<std::shared_ptr<GdLoadFuture::State>> queue;
+	std::shared_ptr<GdLoadFuture::State> current;
+	std::mutex mutex;
+	std::condition_variable cond;
+	std::thread thread;
+	bool running = false;
+	uint64_t loaded = 0, failed = 0;
+
+	static void _finish(GdLoadFuture::State *state, int status, const Ref<Resource> &resource = Ref<Resource>()) {
+		std::lock_guard<std::mutex> lock(state->mutex);
+		state->resource = resource;
+		state->status = status;
+		state->cond.notify_all();
+	}
+
+	void _load(GdLoadFuture::State *state) {
+		state->status = GdLoadFuture::LOADING;
+		Ref<ResourceInteractiveLoader> ril = ResourceLoader::load_interactive(state->path, state->type_hint);
+		if (ril.is_null()) {
+			_finish(state, GdLoadFuture::FAILED);
+			return;
+		}
+		state->stage_count = ril->get_stage_count();
+		while (!state->cancelled) {
+			const Error err = ril->poll();
+			state->stage = ril->get_stage();
+			if (err == ERR_FILE_EOF) {
+				_finish(state, GdLoadFuture::DONE, ril->get_resource());
+				return;
+			} else if (err != OK) {
+				break;
+			}
+		}
+		_finish(state, GdLoadFuture::FAILED);
+	}
+
+	void _run() {
+		while (true) {
+			std::shared_ptr<GdLoadFuture::State> state;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				cond.wait(lock, [this]() { return !running || !queue.empty(); });
+				if (!running) {
+					break;
+				}
+				state = std::move(queue.front());
+				queue.pop_front();
+				current = state;
+			}
+			if (state->cancelled) {
+				_finish(state.get(), GdLoadFuture::FAILED);
+			} else {
+				_load(state.get());
+			}
+			std::lock_guard<std::mutex> lock(mutex);
+			(state->status.load() == GdLoadFuture::DONE ? loaded : failed)++;
+			current.reset();
+		}
+	}
+
+	std::shared_ptr<GdLoadFuture::State> submit(const String &path, const String &type_hint) {
+		auto state = std::make_shared<GdLoadFuture::State>();
+		state->path = path;
+		state->type_hint = type_hint;
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!running) {
+			running = true;
+			thread = std::thread(&GdAsyncLoader::_run, this);
+		}
+		queue.push_back(state);
+		cond.notify_one();
+		return state;
+	}
+
+	// Future finished without loading anything (resolved by result())
+	static std::shared_ptr<GdLoadFuture::State> completed(const String &path) {
+		auto state = std::make_shared<GdLoadFuture::State>();
+		state->path = path;
+		state->status = GdLoadFuture::DONE;
+		return state;
+	}
+
+	py::dict get_stats() {
+		std::lock_guard<std::mutex> lock(mutex);
+		py::dict stats;
+		stats["pending"] = queue.size();
+		stats["loaded"] = loaded;
+		stats["failed"] = failed;
+		return stats;
+	}
+
+	// Pending futures fail, the current load is interrupted
+	void stop() {
+		std::deque<std::shared_ptr<GdLoadFuture::State>> pending;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (!running) {
+				return;
+			}
+			running = false;
+			pending.swap(queue);
+			if (current) {
+				current->cancelled = true;
+			}
+			cond.notify_one();
+		}
+		for (auto &state : pending) {
+			_finish(state.get(), GdLoadFuture::FAILED);
+		}
+		// interrupted load may still wait for the main thread (see GdLoadFuture::wait)
+		if (Thread::get_caller_id() == Thread::get_main_id() && VisualServer::get_singleton()) {
+			std::unique_lock<std::mutex> lock(mutex);
+			while (current) {
+				lock.unlock();
+				VisualServer::get_singleton()->sync(); // runs calls queued by the loader thread
+				lock.lock();
+				cond.wait_for(lock, std::chrono::milliseconds(1));
+			}
+		}
+		thread.join();
+	}
+
+	~GdAsyncLoader() { stop(); }
+} _loader;
+
+// Coroutines (Python generators) resumed by the application instance. Waiting
+// coroutines are kept in a frame wheel, a timer heap, a signal table or a list
+// of pending loads and are not touched until they are due.
+struct GdScheduler {
+	static const int WHEEL_SIZE = 64;
+
+	struct Task {
+		uint32_t id;
+		uint64_t due; // frame (wheel) or usec (timers)
+		py::object gen;
+	};
+
+	std::vector<Task> wheel[WHEEL_SIZE];
+	std::vector<Task> timers; // min-heap on due
+	std::unordered_map<uint32_t, Task> signals;
+	std::vector<std::pair<Task, std::shared_ptr<GdLoadFuture::State>>> loading;
+	std::vector<Task> ready, resumed;
+	std::unordered_set<uint32_t> alive;
+
+	// Coroutines waiting for a signal: one (one shot) connection per object
+	// and signal, all waiting coroutines are woken when it is emitted
+	typedef std::pair<int, std::string> SignalKey;
+
+	std::mutex woken_mutex; // signals are delivered on the main thread
+	std::map<SignalKey, std::vector<uint32_t>> waiting;
+	std::vector<uint32_t> woken;
+
+	uint64_t frame = 0;
+	uint32_t last_id = 0;
+	int instance_id = 0; // connection target for wait_signal
+
+	static _FORCE_INLINE_ GdScheduler *&current() {
+		static thread_local GdScheduler *_current = nullptr;
+		return _current;
+	}
+
+	// Scheduler used by gdgame.sched while running application code
+	struct Scope {
+		GdScheduler *prev;
+		Scope(GdScheduler *sched) : prev(current()) { current() = sched; }
+		~Scope() { current() = prev; }
+	};
+
+	static _FORCE_INLINE_ bool _later(const Task &a, const Task &b) { return a.due > b.due; }
+
+	uint32_t start(const py::object &gen) {
+		if (!PyIter_Check(gen.ptr())) {
+			throw py::type_error("Coroutine has to be a generator");
+		}
+		const uint32_t id = ++last_id;
+		alive.insert(id);
+		ready.push_back(Task{ id, 0, gen }); // first step with the next run
+		return id;
+	}
+
+	void _disconnect(const SignalKey &key) {
+		Object *obj = ObjectDB::get_instance(key.first);
+		Object *target = ObjectDB::get_instance(instance_id);
+		if (obj == nullptr || target == nullptr) {
+			return;
+		}
+		const StringName signal = key.second.c_str();
+		if (Thread::get_caller_id() == Thread::get_main_id()) {
+			if (obj->is_connected(signal, target, "_resume_coroutine")) {
+				obj->disconnect(signal, target, "_resume_coroutine");
+			}
+		} else {
+			MessageQueue::get_singleton()->push_call(obj, "disconnect", signal, target, "_resume_coroutine");
+		}
+	}
+
+	// Stopped coroutine is dropped from wherever it waits
+	bool stop(uint32_t id) {
+		if (alive.erase(id) == 0) {
+			return false;
+		}
+		if (signals.erase(id)) {
+			bool unused = false;
+			SignalKey key;
+			{
+				std::lock_guard<std::mutex> lock(woken_mutex);
+				for (auto it = waiting.begin(); it != waiting.end(); ++it) {
+					std::vector<uint32_t> &ids = it->second;
+					auto found = std::find(ids.begin(), ids.end(), id);
+					if (found != ids.end()) {
+						ids.erase(found);
+						if (ids.empty()) {
+							unused = true;
+							key = it->first;
+							waiting.erase(it);
+						}
+						break;
+					}
+				}
+			}
+			if (unused) {
+				_disconnect(key);
+			}
+			return true;
+		}
+		auto timer = std::find_if(timers.begin(), timers.end(), [id](const Task &t) { return t.id == id; });
+		if (timer != timers.end()) {
+			timers.erase(timer);
+			std::make_heap(timers.begin(), timers.end(), _later);
+			return true;
+		}
+		loading.erase(std::remove_if(loading.begin(), loading.end(), [id](const std::pair<Task, std::shared_ptr<GdLoadFuture::State>> &l) { return l.first.id == id; }), loading.end());
+		return true;
+	}
+
+	_FORCE_INLINE_ size_t count() const { return alive.size(); }
+
+	// Signal emitted (main thread): coroutines waiting for it run next frame
+	void wake(int p_instance_id, const std::string &p_signal) {
+		std::lock_guard<std::mutex> lock(woken_mutex);
+		auto it = waiting.find(SignalKey(p_instance_id, p_signal));
+		if (it != waiting.end()) {
+			woken.insert(woken.end(), it->second.begin(), it->second.end());
+			waiting.erase(it); // one shot connection is gone
+		}
+	}
+
+	void suspend(Task &task, const py::object &res) {
+		if (res.is_none()) {
+			task.due = frame + 1;
+			wheel[task.due % WHEEL_SIZE].push_back(std::move(task));
+		} else if (py::isinstance<GdWait>(res)) {
+			const GdWait &w = res.cast<const GdWait &>();
+			switch (w.type) {
+				case GdWait::FRAMES: {
+					task.due = frame + MAX(w.frames, 1);
+					wheel[task.due % WHEEL_SIZE].push_back(std::move(task));
+				} break;
+				case GdWait::SECONDS: {
+					task.due = OS::get_singleton()->get_ticks_usec() + uint64_t(MAX(w.seconds, real_t(0)) * 1000000);
+					timers.push_back(std::move(task));
+					std::push_heap(timers.begin(), timers.end(), _later);
+				} break;
+				case GdWait::SIGNAL: {
+					Object *obj = ObjectDB::get_instance(w.instance_id);
+					Object *target = ObjectDB::get_instance(instance_id);
+					if (obj == nullptr || target == nullptr) {
+						WARN_PRINT("Coroutine is waiting for signal of unknown object");
+						alive.erase(task.id);
+						break;
+					}
+					bool connect;
+					{
+						std::lock_guard<std::mutex> lock(woken_mutex);
+						std::vector<uint32_t> &ids = waiting[SignalKey(w.instance_id, w.signal)];
+						connect = ids.empty();
+						ids.push_back(task.id);
+					}
+					if (connect) {
+						// binds identify the signal, connection is per (signal, target, method)
+						const StringName signal = w.signal.c_str();
+						const Vector<Variant> binds = varray(w.instance_id, String(w.signal.c_str()));
+						if (Thread::get_caller_id() == Thread::get_main_id()) {
+							obj->connect(signal, target, "_resume_coroutine", binds, Object::CONNECT_ONESHOT);
+						} else {
+							MessageQueue::get_singleton()->push_call(obj, "connect", signal, target, "_resume_coroutine", binds, Object::CONNECT_ONESHOT);
+						}
+					}
+					signals.emplace(task.id, std::move(task));
+				} break;
+			}
+		} else if (py::isinstance<GdLoadFuture>(res)) {
+			const GdLoadFuture &f = res.cast<const GdLoadFuture &>();
+			if (f.done()) {
+				task.due = frame + 1;
+				wheel[task.due % WHEEL_SIZE].push_back(std::move(task));
+			} else {
+				loading.emplace_back(std::move(task), f.state);
+			}
+		} else {
+			WARN_PRINT("Unexpected value yielded by coroutine: waiting one frame");
+			task.due = frame + 1;
+			wheel[task.due % WHEEL_SIZE].push_back(std::move(task));
+		}
+	}
+
+	void resume(Task &task) {
+		if (!alive.count(task.id)) {
+			return; // stopped
+		}
+		PyObject *res = PyIter_Next(task.gen.ptr());
+		if (res == nullptr) {
+			if (PyErr_Occurred()) {
+				PyErr_Print();
+			}
+			alive.erase(task.id);
+			return;
+		}
+		suspend(task, py::reinterpret_steal<py::object>(res));
+	}
+
+	// Resume coroutines due in this frame
+	void run() {
+		frame++;
+		{
+			std::lock_guard<std::mutex> lock(woken_mutex);
+			for (const uint32_t id : woken) {
+				auto it = signals.find(id);
+				if (it != signals.end()) {
+					ready.push_back(std::move(it->second));
+					signals.erase(it);
+				}
+			}
+			woken.clear();
+		}
+		std::vector<Task> &slot = wheel[frame % WHEEL_SIZE];
+		for (Task &task : slot) {
+			if (task.due <= frame) {
+				ready.push_back(std::move(task));
+			} else {
+				resumed.push_back(std::move(task)); // next turn of the wheel
+			}
+		}
+		slot.clear();
+		slot.swap(resumed);
+		if (!loading.empty()) {
+			auto finished = std::partition(loading.begin(), loading.end(), [](const std::pair<Task, std::shared_ptr<GdLoadFuture::State>> &l) { return !l.second->is_finished(); });
+			for (auto it = finished; it != loading.end(); ++it) {
+				ready.push_back(std::move(it->first));
+			}
+			loading.erase(finished, loading.end());
+		}
+		if (!timers.empty()) {
+			const uint64_t now = OS::get_singleton()->get_ticks_usec();
+			while (!timers.empty() && timers.front().due <= now) {
+				std::pop_heap(timers.begin(), timers.end(), _later);
+				ready.push_back(std::move(timers.back()));
+				timers.pop_back();
+			}
+		}
+		if (!ready.empty()) {
+			resumed.swap(ready); // coroutines started now are run next frame
+			for (Task &task : resumed) {
+				resume(task);
+			}
+			resumed.clear();
+		}
+	}
+
+	void clear() {
+		for (int i = 0; i < WHEEL_SIZE; i++) {
+			wheel[i].clear();
+		}
+		timers.clear();
+		signals.clear();
+		loading.clear();
+		ready.clear();
+		resumed.clear();
+		alive.clear();
+		std::lock_guard<std::mutex> lock(woken_mutex);
+		waiting.clear();
+		woken.clear();
+	}
+};
+
 // Wrapper around Godot sound
 struct GdSound {
 	GdSound(const std::string &filename) { }
@@ -558,6 +2534,35 @@ struct GdSound {
 	void stop();
 };
 
+// Read-only file contents exposed with the buffer protocol: files with own OS
+// file are mapped (no copy), packed files are read to memory
+struct GdMappedFile {
+	const unsigned char *map = nullptr;
+	Vector<uint8_t> bytes;
+	const uint8_t *data = nullptr;
+	size_t size = 0;
+
+	_FORCE_INLINE_ bool is_mapped() const { return map != nullptr; }
+
+	GdMappedFile(const std::string &path) {
+		map = pymmap(path.c_str(), &size);
+		if (map) {
+			data = map;
+			return;
+		}
+		Error err;
+		bytes = FileAccess::get_file_as_array(path.c_str(), &err);
+		if (err != OK) {
+			throw std::runtime_error("Cannot open file: " + path);
+		}
+		data = bytes.ptr();
+		size = bytes.size();
+	}
+	GdMappedFile(const GdMappedFile &) = delete;
+	GdMappedFile &operator=(const GdMappedFile &) = delete;
+	~GdMappedFile() { pymunmap(map); }
+};
+
 namespace utils {
 	void print_dict(py::dict dict) {
 		for (auto item : dict)
@@ -584,7 +2589,8 @@ namespace utils {
 	std::tuple<int, int> get_instance_size(int instance_id) {
 		if (Object *owner = ObjectDB::get_instance(instance_id)) {
 			if (Node2D *canvas = Object::cast_to<Node2D>(owner)) {
-				Size2 size = canvas->call("get_view_size");
+				Size2 size;
+				GdMainCalls::run([canvas, &size] { size = canvas->call("get_view_size"); });
 				return std::make_tuple(size.width, size.height);
 			} else {
 				WARN_PRINT("Not an CanvasItem");
@@ -607,23 +2613,192 @@ namespace event {
 	}
 } // event
 
+namespace sched {
+	_FORCE_INLINE_ GdScheduler *get_current() {
+		GdScheduler *sched = GdScheduler::current();
+		if (sched == nullptr) {
+			throw std::runtime_error("Coroutines can be started from application callbacks only");
+		}
+		return sched;
+	}
+	_FORCE_INLINE_ uint32_t start(const py::object &gen) { return get_current()->start(gen); }
+	_FORCE_INLINE_ bool stop(uint32_t id) { return get_current()->stop(id); }
+	_FORCE_INLINE_ size_t count() { return get_current()->count(); }
+	_FORCE_INLINE_ GdWait wait_frames(int frames) { return GdWait{ GdWait::FRAMES, frames, 0, 0, "" }; }
+	_FORCE_INLINE_ GdWait wait_seconds(real_t seconds) { return GdWait{ GdWait::SECONDS, 0, seconds, 0, "" }; }
+	_FORCE_INLINE_ GdWait wait_signal(int instance_id, const std::string &signal) { return GdWait{ GdWait::SIGNAL, 0, 0, instance_id, signal }; }
+} // sched
+
+// Small images loaded with image.load packed into shared atlas pages (opt-in),
+// so sprites from different files can be batched together. Pages are filled
+// shelf by shelf and each image is uploaded to its region when loaded (pages
+// are never rebuilt, space of released images is not reused). Images get
+// 1px border with extruded edges against filtering bleed.
+struct GdAtlasPacker {
+	static const int PADDING = 1;
+
+	// pages created before page_size changed keep their size
+	struct Page : GdShelfPacker {
+		Ref<ImageTexture> texture;
+		uint32_t flags;
+	};
+
+	bool enabled = false;
+	int page_size = 1024;
+	int max_size = 256; // larger images keep their own texture
+	std::vector<Page> pages;
+	std::unordered_map<std::string, Ref<AtlasTexture>> regions; // loaded files
+
+	void configure(bool p_enabled, int p_page_size, int p_max_size) {
+		enabled = p_enabled;
+		page_size = CLAMP(p_page_size, 64, 8192);
+		max_size = CLAMP(p_max_size, 1, page_size - 2 * PADDING);
+	}
+
+	// Image with edges extruded into the border
+	static Ref<Image> _padded(const Ref<Image> &p_image) {
+		const int w = p_image->get_width(), h = p_image->get_height();
+		Ref<Image> padded = memnew(Image(w + 2 * PADDING, h + 2 * PADDING, false, Image::FORMAT_RGBA8));
+		padded->blit_rect(p_image, Rect2(0, 0, w, h), Point2(PADDING, PADDING));
+		padded->blit_rect(p_image, Rect2(0, 0, w, 1), Point2(PADDING, 0));
+		padded->blit_rect(p_image, Rect2(0, h - 1, w, 1), Point2(PADDING, h + PADDING));
+		Ref<Image> rows = padded->duplicate();
+		padded->blit_rect(rows, Rect2(PADDING, 0, 1, h + 2 * PADDING), Point2(0, 0));
+		padded->blit_rect(rows, Rect2(w + PADDING - 1, 0, 1, h + 2 * PADDING), Point2(w + PADDING, 0));
+		return padded;
+	}
+
+	Page &_new_page(uint32_t p_flags) {
+		pages.push_back(Page());
+		Page &page = pages.back();
+		page.flags = p_flags;
+		page.size = page_size;
+		page.texture.instance();
+		page.texture->create_from_image(memnew(Image(page_size, page_size, false, Image::FORMAT_RGBA8)), p_flags);
+		return page;
+	}
+
+	// Texture packed into a page or the texture itself when it does not fit
+	Ref<Texture> pack(const String &p_path, const Ref<Texture> &p_texture) {
+		if (!enabled || p_texture.is_null() || Object::cast_to<AtlasTexture>(p_texture.ptr()) || Thread::get_caller_id() != Thread::get_main_id()) {
+			return p_texture;
+		}
+		if (p_texture->get_width() > max_size || p_texture->get_height() > max_size) {
+			return p_texture;
+		}
+		const std::string key = std::str(p_path);
+		auto it = regions.find(key);
+		if (it != regions.end()) {
+			return it->second;
+		}
+		Ref<Image> image = p_texture->get_data();
+		if (image.is_null()) {
+			return p_texture;
+		}
+		image = image->duplicate();
+		if (image->is_compressed()) {
+			image->decompress();
+		}
+		image->clear_mipmaps();
+		image->convert(Image::FORMAT_RGBA8);
+
+		const uint32_t flags = p_texture->get_flags() & ~Texture::FLAG_MIPMAPS; // partial updates
+		const int w = image->get_width() + 2 * PADDING, h = image->get_height() + 2 * PADDING;
+		Point2 pos;
+		Page *page = nullptr;
+		for (Page &p : pages) {
+			if (p.flags == flags && p.insert(w, h, pos)) {
+				page = &p;
+				break;
+			}
+		}
+		if (page == nullptr) {
+			page = &_new_page(flags);
+			if (!page->insert(w, h, pos)) {
+				return p_texture;
+			}
+		}
+		VisualServer::get_singleton()->texture_set_data_partial(page->texture->get_rid(), _padded(image), 0, 0, w, h, pos.x, pos.y, 0);
+		Ref<AtlasTexture> region;
+		region.instance();
+		region->set_atlas(page->texture);
+		region->set_region(Rect2(pos + Point2(PADDING, PADDING), image->get_size()));
+		regions[key] = region;
+		return region;
+	}
+
+	py::list get_stats() const {
+		py::list stats;
+		for (const Page &page : pages) {
+			stats.append(py::dict(
+					py::arg("size") = page.size,
+					py::arg("images") = page.images,
+					py::arg("used") = page.used,
+					py::arg("occupancy") = double(page.used) / (double(page.size) * page.size)));
+		}
+		return stats;
+	}
+
+	void clear() {
+		regions.clear();
+		pages.clear();
+	}
+} _atlas;
+
 namespace image {
 	_FORCE_INLINE_ GdSurface load(const std::string &filename) {
+		if (_atlas.enabled) {
+			const String path = filename.c_str();
+			return GdSurface(std::make_unique<GdTextureSurface>(_atlas.pack(path, ResourceLoader::load(path, "Texture"))));
+		}
 		return GdSurface(filename.c_str());
 	}
+	_FORCE_INLINE_ void set_atlas(bool enabled, int page_size, int max_size) { _atlas.configure(enabled, page_size, max_size); }
+	_FORCE_INLINE_ py::list get_atlas_stats() { return _atlas.get_stats(); }
 	_FORCE_INLINE_ bool exists(const std::string &filename) {
 		return ResourceLoader::exists(filename.c_str());
 	}
+	// pixel addressable surfaces
+	_FORCE_INLINE_ GdSurface create(int width, int height) {
+		return GdSurface(std::make_unique<GdImageSurface>(width, height));
+	}
+	_FORCE_INLINE_ GdSurface load_pixels(const std::string &filename) {
+		Ref<Texture> texture = ResourceLoader::load(filename.c_str(), "Texture");
+		if (texture.is_null() || texture->get_data().is_null()) {
+			WARN_PRINT("Failed to load image: " + String(filename.c_str()));
+			return create(1, 1);
+		}
+		return GdSurface(std::make_unique<GdImageSurface>(texture->get_data()));
+	}
+	// background loading
+	_FORCE_INLINE_ GdLoadFuture load_async(const std::string &filename) {
+		GdLoadFuture future{ _loader.submit(filename.c_str(), "Texture"), GdLoadFuture::IMAGE, filename };
+		return future;
+	}
 } // image
 
+namespace font {
+	// Font data is loaded in background (TrueType and bitmap fonts), the font
+	// itself is created from the resource cache when the result is requested
+	_FORCE_INLINE_ GdLoadFuture load_async(const std::string &path, int size, int outline_size, const std::vector<uint8_t> &outline_color, int stretch) {
+		const String ext = String(path.c_str()).get_extension();
+		std::shared_ptr<GdLoadFuture::State> state;
+		if (ext == "ttf" || ext == "otf") {
+			state = _loader.submit(path.c_str(), "DynamicFontData");
+		} else if (ext == "fnt") {
+			state = _loader.submit(path.c_str(), "BitmapFont");
+		} else {
+			state = GdAsyncLoader::completed(path.c_str());
+		}
+		GdLoadFuture future{ state, GdLoadFuture::FONT, path, size, outline_size, stretch, vec_to_color(outline_color) };
+		return future;
+	}
+} // font
+
 namespace draw {
 	_FORCE_INLINE_ void rect(const GdSurface &surf, const Color &c, const Rect2 &geom, int width) {
 		ERR_FAIL_COND(surf.get_surface_type() != GdSurfaceImpl::DISPLAY_SURFACE);
-		if (Node2D *canvas = Object::cast_to<Node2D>(surf.get_as_display()->instance)) {
-			canvas->draw_rect(geom, c, false, width);
-		} else {
-			WARN_PRINT("Not an Node2D");
-		}
+		surf.get_as_display()->render_outline_rect(geom, c, width);
 	}
 	_FORCE_INLINE_ void rect(const GdSurface &surf, const std::vector<uint8_t> &c, const Rect2 &geom, int width) {
 		rect(surf, vec_to_color(c), geom, width);
@@ -637,7 +2812,35 @@ namespace draw {
 	}
 	_FORCE_INLINE_ void style_rect(const GdSurface &surf, const Color &color, const Rect2 &rect, int width, int radius, const Color &bg_color, int shadow_size, const Color &shadow_color, const Vector2 &shadow_offset) {
 		ERR_FAIL_COND(surf.get_surface_type() != GdSurfaceImpl::DISPLAY_SURFACE);
-		if (Node2D *canvas = Object::cast_to<Node2D>(surf.get_as_display()->instance)) {
+		if (GdDisplaySurface::recorder()) {
+			// recorded style is drawn later: one style per parameters is kept,
+			// so retained layers with the same styles are not re-emitted
+			typedef std::tuple<int, int, uint32_t, int, uint32_t, real_t, real_t> StyleKey;
+			static std::map<StyleKey, Ref<StyleBoxFlat>> _styles;
+			static std::mutex _styles_mutex; // recorded by the worker or the main thread
+			const StyleKey key(width, radius, bg_color.to_rgba32(), shadow_size, shadow_color.to_rgba32(), shadow_offset.x, shadow_offset.y);
+			Ref<StyleBoxFlat> style;
+			{
+				std::lock_guard<std::mutex> lock(_styles_mutex);
+				auto it = _styles.find(key);
+				if (it != _styles.end()) {
+					style = it->second;
+				} else {
+					style = newref(StyleBoxFlat);
+					style->set_border_width_all(width);
+					style->set_corner_radius_all(radius);
+					style->set_bg_color(bg_color);
+					style->set_shadow_size(shadow_size);
+					style->set_shadow_color(shadow_color);
+					style->set_shadow_offset(shadow_offset);
+					if (_styles.size() < 64) {
+						_styles[key] = style;
+						_register_global_ref(style); // remove at exit
+					}
+				}
+			}
+			surf.get_as_display()->render_style_box(style, rect);
+		} else if (Node2D *canvas = Object::cast_to<Node2D>(surf.get_as_display()->instance)) {
 			static Ref<StyleBoxFlat> _style;
 			if (!_style) {
 				_style = newref(StyleBoxFlat);
@@ -659,6 +2862,90 @@ namespace draw {
 		ERR_FAIL_COND(shadow_offset.size()!=2);
 		style_rect(surf, vec_to_color(color), Rect2(rect[0], rect[1], rect[2], rect[3]), width, radius, vec_to_color(bg_color), shadow_size, vec_to_color(shadow_color), Vector2(shadow_offset[0], shadow_offset[1]));
 	}
+
+	// Sprite records: float32 values packed in any object exposing a buffer
+	// (array.array('f'), bytearray, struct.pack output, PoolRealArray)
+	struct _SpriteBuffer : GdBufferView {
+		const float *data = nullptr;
+		size_t count = 0; // number of floats
+
+		_SpriteBuffer(const py::object &p_obj) : GdBufferView(p_obj) {
+			if (!is_format("f", sizeof(float))) {
+				throw py::type_error("Sprite buffer must contain float32 values");
+			}
+			if (len % sizeof(float)) {
+				throw py::value_error("Sprite buffer size is not multiple of float32 size");
+			}
+			data = (const float *)ptr;
+			count = len / sizeof(float);
+		}
+	};
+
+	// Records of `components` floats drawn in one loop:
+	//   sprites: 2 - x, y; 4 - x, y, w, h; 8 - x, y, w, h, r, g, b, a
+	//   regions: 6 - x, y, rx, ry, rw, rh; 8 - x, y, w, h, rx, ry, rw, rh; 12 - with r, g, b, a
+	static void _sprites(const GdSurface &surf, const GdSurface &image, const py::object &buffer, int components, bool regions) {
+		ERR_FAIL_COND(surf.get_surface_type() != GdSurfaceImpl::DISPLAY_SURFACE);
+		ERR_FAIL_COND(image.get_surface_type() != GdSurfaceImpl::TEXTURE_SURFACE);
+		if (regions ? (components != 6 && components != 8 && components != 12) : (components != 2 && components != 4 && components != 8)) {
+			throw py::value_error(std::str(vformat("Invalid number of components: %d", components)));
+		}
+		const Ref<Texture> &texture = image.get_as_texture()->texture;
+		ERR_FAIL_NULL(texture);
+		_SpriteBuffer records(buffer);
+		const size_t count = records.count / components;
+
+		GdDisplaySurface *disp = surf.get_as_display();
+		GdRenderQueue *queue = GdDisplaySurface::recorder();
+		CanvasItem *canvas = queue ? nullptr : Object::cast_to<CanvasItem>(disp->instance);
+		if (queue == nullptr && canvas == nullptr) {
+			WARN_PRINT("Not an CanvasItem");
+			return;
+		}
+		static GdRenderBatcher _batcher; // main thread only
+		const bool batch = queue == nullptr && GdRenderBatcher::enabled();
+
+		const Size2 size = texture->get_size();
+		Rect2 dest(Point2(), size), area(Point2(), size);
+		Color color(1, 1, 1, 1);
+		for (size_t i = 0; i < count; i++) {
+			const float *r = records.data + i * components;
+			dest.position = Point2(r[0], r[1]);
+			if (regions) {
+				if (components == 6) {
+					area = Rect2(r[2], r[3], r[4], r[5]);
+					dest.size = area.size;
+				} else {
+					dest.size = Size2(r[2], r[3]);
+					area = Rect2(r[4], r[5], r[6], r[7]);
+					if (components == 12) {
+						color = Color(r[8], r[9], r[10], r[11]);
+					}
+				}
+			} else if (components >= 4) {
+				dest.size = Size2(r[2], r[3]);
+				if (components == 8) {
+					color = Color(r[4], r[5], r[6], r[7]);
+				}
+			}
+			if (queue) {
+				queue->push(texture, dest, area, color);
+			} else if (batch) {
+				_batcher.add_texture(texture.ptr(), dest, area, color);
+			} else {
+				canvas->draw_texture_rect_region(texture, dest, area, color);
+			}
+		}
+		if (batch) {
+			_batcher.finish(canvas->get_canvas_item());
+		}
+	}
+	_FORCE_INLINE_ void sprites(const GdSurface &surf, const GdSurface &image, const py::object &buffer, int components) {
+		_sprites(surf, image, buffer, components, false);
+	}
+	_FORCE_INLINE_ void sprite_regions(const GdSurface &surf, const GdSurface &image, const py::object &buffer, int components) {
+		_sprites(surf, image, buffer, components, true);
+	}
 } // draw
 
 namespace display {
@@ -675,6 +2962,32 @@ namespace display {
 			_surf_stats.disable();
 		}
 	}
+	_FORCE_INLINE_ py::dict get_render_stats() {
+		return py::dict(
+			py::arg("commands") = _render_stats.last_commands,
+			py::arg("draw_calls") = _render_stats.last_draw_calls,
+			py::arg("saved") = _render_stats.last_commands - _render_stats.last_draw_calls,
+			py::arg("layers_updated") = _render_stats.last_layers_updated,
+			py::arg("layers_kept") = _render_stats.last_layers_kept,
+			py::arg("text_hits") = _text_cache.hits,
+			py::arg("text_misses") = _text_cache.misses,
+			py::arg("text_cached") = _text_cache.size());
+	}
+	// select layer for following commands (retained drawing only)
+	_FORCE_INLINE_ void layer(int index) {
+		if (GdRetainedCanvas *canvas = GdRetainedCanvas::current()) {
+			canvas->select(index);
+		}
+	}
+	// layer content is the same as in the previous frame
+	_FORCE_INLINE_ void keep_layer(int index) {
+		if (GdRetainedCanvas *canvas = GdRetainedCanvas::current()) {
+			canvas->keep(index);
+		}
+	}
+	_FORCE_INLINE_ py::dict get_surface_stats() { return _surf_stats.get_stats(); }
+	_FORCE_INLINE_ void set_batching(bool state) { GdRenderBatcher::enabled() = state; }
+	_FORCE_INLINE_ void set_auto_bake(bool state) { GdSurface::auto_bake() = state; }
 	_FORCE_INLINE_ void mirror(int instance_id) {
 		if (Object *owner = ObjectDB::get_instance(instance_id)) {
 			if (Node2D *canvas = Object::cast_to<Node2D>(owner)) {
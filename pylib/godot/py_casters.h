@@ -0,0 +1,399 @@
+#ifndef PY_CASTERS_H
+#define PY_CASTERS_H
+
+#include "pybind11/pybind11.h"
+
+#include "core/array.h"
+#include "core/color.h"
+#include "core/dictionary.h"
+#include "core/pool_vector.h"
+#include "core/variant.h"
+#include "core/math/rect2.h"
+#include "core/math/vector2.h"
+#include "core/math/vector3.h"
+
+#include <climits>
+
+// Godot containers crossing the Python boundary:
+//  * Array/Dictionary are converted to list/dict (and back)
+//  * Pool*Array are wrapped in a view object sharing Godot storage, with
+//    the buffer protocol pointing directly to the pool memory
+
+// Pool array shared with Python (read-only for arrays coming from the engine,
+// writable for arrays created in Python). The pool memory is locked only per
+// item access and while a buffer is exported (read lock, or write lock which
+// detaches storage shared with a copy first) - locked pool array cannot be
+// resized.
+template <typename T>
+struct GdPoolArrayView {
+	PoolVector<T> array;
+	typename PoolVector<T>::Read r;
+	typename PoolVector<T>::Write w;
+	int views = 0; // exported buffers
+	bool writable;
+
+	GdPoolArrayView(const PoolVector<T> &p_array) : array(p_array), writable(false) {}
+	GdPoolArrayView(int p_size) : writable(true) {
+		array.resize(MAX(p_size, 0));
+	}
+
+	_FORCE_INLINE_ int size() const { return array.size(); }
+	_FORCE_INLINE_ int index(int p_index) const {
+		if (p_index < 0) {
+			p_index += size();
+		}
+		if (p_index < 0 || p_index >= size()) {
+			throw pybind11::index_error();
+		}
+		return p_index;
+	}
+	_FORCE_INLINE_ T at(int p_index) const {
+		return array.read()[index(p_index)];
+	}
+	_FORCE_INLINE_ void set(int p_index, const T &p_value) {
+		if (!writable) {
+			throw pybind11::value_error("Pool array view is read-only");
+		}
+		const int i = index(p_index);
+		array.write()[i] = p_value; // copy on write
+	}
+
+	// Pool memory locked until the last exported buffer is released
+	const T *lock() {
+		if (views++ == 0) {
+			if (writable) {
+				w = array.write();
+			} else {
+				r = array.read();
+			}
+		}
+		return writable ? w.ptr() : r.ptr();
+	}
+	void release_buffer() {
+		if (views > 0 && --views == 0) {
+			w = typename PoolVector<T>::Write();
+			r = typename PoolVector<T>::Read();
+		}
+	}
+};
+
+typedef GdPoolArrayView<uint8_t> GdPoolByteArrayView;
+typedef GdPoolArrayView<real_t> GdPoolRealArrayView;
+typedef GdPoolArrayView<Vector2> GdPoolVector2ArrayView;
+
+// Buffer description of the pool memory
+static _FORCE_INLINE_ pybind11::buffer_info _pool_buffer_info(GdPoolByteArrayView &v) {
+	return pybind11::buffer_info((void *)v.lock(), sizeof(uint8_t), pybind11::format_descriptor<uint8_t>::format(), v.size(), !v.writable);
+}
+
+static _FORCE_INLINE_ pybind11::buffer_info _pool_buffer_info(GdPoolRealArrayView &v) {
+	return pybind11::buffer_info((void *)v.lock(), sizeof(real_t), pybind11::format_descriptor<real_t>::format(), v.size(), !v.writable);
+}
+
+static _FORCE_INLINE_ pybind11::buffer_info _pool_buffer_info(GdPoolVector2ArrayView &v) {
+	return pybind11::buffer_info((void *)v.lock(), sizeof(real_t), pybind11::format_descriptor<real_t>::format(), 2, { ssize_t(v.size()), ssize_t(2) }, { ssize_t(sizeof(Vector2)), ssize_t(sizeof(real_t)) }, !v.writable);
+}
+
+// Read-only view of any object exposing a buffer: new style buffer protocol
+// or old style one (e.g. array.array in Python 2). Format is null for old
+// style buffers (plain bytes).
+struct GdBufferView {
+	Py_buffer view;
+	bool release = false;
+	const void *ptr = nullptr;
+	Py_ssize_t len = 0;
+	Py_ssize_t itemsize = 1;
+	const char *format = nullptr;
+
+	GdBufferView(pybind11::handle p_obj) {
+		if (PyObject_CheckBuffer(p_obj.ptr()) && PyObject_GetBuffer(p_obj.ptr(), &view, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) == 0) {
+			release = true;
+			ptr = view.buf;
+			len = view.len;
+			itemsize = view.itemsize;
+			format = view.format;
+			return;
+		}
+		PyErr_Clear();
+		if (PyObject_AsReadBuffer(p_obj.ptr(), &ptr, &len) != 0) {
+			throw pybind11::error_already_set();
+		}
+	}
+	GdBufferView(const GdBufferView &) = delete;
+	GdBufferView &operator=(const GdBufferView &) = delete;
+	~GdBufferView() {
+		if (release) {
+			PyBuffer_Release(&view);
+		}
+	}
+
+	// Items are bytes (unsigned or signed chars)
+	_FORCE_INLINE_ bool is_bytes() const { return itemsize == 1 && (format == nullptr || strchr("Bbc", format[0])); }
+	// Items have given format (bytes are accepted as raw data)
+	_FORCE_INLINE_ bool is_format(const std::string &p_format, Py_ssize_t p_itemsize) const {
+		return is_bytes() || (itemsize == p_itemsize && format && p_format == format);
+	}
+};
+
+namespace pybind11 {
+namespace detail {
+
+// Copy contiguous buffer with matching item type into the pool array
+template <typename T>
+static bool _load_pool_buffer(handle p_src, size_t p_components, PoolVector<T> &r_array) {
+	typedef typename std::conditional<std::is_same<T, Vector2>::value, real_t, T>::type Item;
+	if (!PyObject_CheckBuffer(p_src.ptr())) {
+		return false;
+	}
+	Py_buffer view;
+	if (PyObject_GetBuffer(p_src.ptr(), &view, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) != 0) {
+		PyErr_Clear();
+		return false;
+	}
+	bool ok = false;
+	if (view.itemsize == sizeof(Item) && view.format && format_descriptor<Item>::format() == std::string(view.format) && view.len % (sizeof(Item) * p_components) == 0) {
+		r_array.resize(view.len / (sizeof(Item) * p_components));
+		if (view.len > 0) {
+			memcpy(r_array.write().ptr(), view.buf, view.len);
+		}
+		ok = true;
+	}
+	PyBuffer_Release(&view);
+	return ok;
+}
+
+template <typename T>
+struct gd_pool_array_caster {
+	typedef PoolVector<T> Type;
+	typedef GdPoolArrayView<T> View;
+
+	PYBIND11_TYPE_CASTER(Type, _("PoolArray"));
+
+	bool load(handle src, bool convert) {
+		if (isinstance<View>(src)) {
+			value = src.cast<const View &>().array; // shared storage
+			return true;
+		}
+		if (_load_pool_buffer<T>(src, std::is_same<T, Vector2>::value ? 2 : 1, value)) {
+			return true;
+		}
+		if (!convert || !isinstance<sequence>(src) || isinstance<str>(src)) {
+			return false;
+		}
+		const sequence seq = reinterpret_borrow<sequence>(src);
+		value.resize(seq.size());
+		typename PoolVector<T>::Write w = value.write();
+		for (size_t i = 0; i < seq.size(); i++) {
+			make_caster<T> item;
+			if (!item.load(seq[i], convert)) {
+				return false;
+			}
+			w[i] = cast_op<T &&>(std::move(item));
+		}
+		return true;
+	}
+
+	static handle cast(const Type &src, return_value_policy /* policy */, handle /* parent */) {
+		return pybind11::cast(View(src), return_value_policy::move).release();
+	}
+};
+
+template <> struct type_caster<PoolByteArray> : gd_pool_array_caster<uint8_t> {};
+template <> struct type_caster<PoolRealArray> : gd_pool_array_caster<real_t> {};
+template <> struct type_caster<PoolVector2Array> : gd_pool_array_caster<Vector2> {};
+
+template <> struct type_caster<Variant> {
+	PYBIND11_TYPE_CASTER(Variant, _("Variant"));
+
+	bool load(handle src, bool convert);
+	static handle cast(const Variant &src, return_value_policy policy, handle parent);
+};
+
+template <> struct type_caster<Array> {
+	PYBIND11_TYPE_CASTER(Array, _("Array"));
+
+	bool load(handle src, bool convert) {
+		if (!isinstance<list>(src) && !isinstance<tuple>(src)) {
+			return false;
+		}
+		const sequence seq = reinterpret_borrow<sequence>(src);
+		value.resize(seq.size());
+		for (size_t i = 0; i < seq.size(); i++) {
+			type_caster<Variant> item;
+			if (!item.load(seq[i], convert)) {
+				return false;
+			}
+			value[i] = std::move(item.value);
+		}
+		return true;
+	}
+
+	static handle cast(const Array &src, return_value_policy policy, handle parent) {
+		list l(src.size());
+		for (int i = 0; i < src.size(); i++) {
+			object item = reinterpret_steal<object>(type_caster<Variant>::cast(src[i], policy, parent));
+			if (!item) {
+				return handle();
+			}
+			PyList_SET_ITEM(l.ptr(), i, item.release().ptr());
+		}
+		return l.release();
+	}
+};
+
+// gdgame.core.Dict (dict with has/size/erase of the former wrapper), set
+// when the module is created (reference is kept for the process lifetime)
+inline handle &_gd_dict_type() {
+	static handle _type;
+	return _type;
+}
+
+template <> struct type_caster<Dictionary> {
+	PYBIND11_TYPE_CASTER(Dictionary, _("Dictionary"));
+
+	bool load(handle src, bool convert) {
+		if (!isinstance<dict>(src)) {
+			return false;
+		}
+		for (auto item : reinterpret_borrow<dict>(src)) {
+			type_caster<Variant> k, v;
+			if (!k.load(item.first, convert) || !v.load(item.second, convert)) {
+				return false;
+			}
+			value[k.value] = v.value;
+		}
+		return true;
+	}
+
+	static handle cast(const Dictionary &src, return_value_policy policy, handle parent) {
+		dict d = _gd_dict_type() ? reinterpret_steal<dict>(PyObject_CallObject(_gd_dict_type().ptr(), nullptr)) : dict();
+		if (!d.ptr()) {
+			return handle();
+		}
+		const Variant *key = nullptr;
+		while ((key = src.next(key))) {
+			object k = reinterpret_steal<object>(type_caster<Variant>::cast(*key, policy, parent));
+			object v = reinterpret_steal<object>(type_caster<Variant>::cast(src[*key], policy, parent));
+			if (!k || !v) {
+				return handle();
+			}
+			d[k] = v;
+		}
+		return d.release();
+	}
+};
+
+inline bool type_caster<Variant>::load(handle src, bool convert) {
+	PyObject *o = src.ptr();
+	if (o == nullptr) {
+		return false;
+	}
+	if (o == Py_None) {
+		value = Variant();
+	} else if (PyBool_Check(o)) {
+		value = o == Py_True;
+	} else if (PyInt_Check(o)) {
+		value = int64_t(PyInt_AS_LONG(o));
+	} else if (PyLong_Check(o)) {
+		const int64_t v = PyLong_AsLongLong(o);
+		if (v == -1 && PyErr_Occurred()) {
+			PyErr_Clear();
+			return false;
+		}
+		value = v;
+	} else if (PyFloat_Check(o)) {
+		value = real_t(PyFloat_AS_DOUBLE(o));
+	} else if (PyString_Check(o)) {
+		String s;
+		s.parse_utf8(PyString_AS_STRING(o), PyString_GET_SIZE(o));
+		value = s;
+	} else if (PyUnicode_Check(o)) {
+		object utf8 = reinterpret_steal<object>(PyUnicode_AsUTF8String(o));
+		if (!utf8) {
+			PyErr_Clear();
+			return false;
+		}
+		String s;
+		s.parse_utf8(PyString_AS_STRING(utf8.ptr()), PyString_GET_SIZE(utf8.ptr()));
+		value = s;
+	} else if (PyList_Check(o) || PyTuple_Check(o)) {
+		type_caster<Array> a;
+		if (!a.load(src, convert)) {
+			return false;
+		}
+		value = a.value;
+	} else if (PyDict_Check(o)) {
+		type_caster<Dictionary> d;
+		if (!d.load(src, convert)) {
+			return false;
+		}
+		value = d.value;
+	} else if (isinstance<Vector2>(src)) {
+		value = src.cast<Vector2>();
+	} else if (isinstance<Vector3>(src)) {
+		value = src.cast<Vector3>();
+	} else if (isinstance<Rect2>(src)) {
+		value = src.cast<Rect2>();
+	} else if (isinstance<Color>(src)) {
+		value = src.cast<Color>();
+	} else if (isinstance<GdPoolByteArrayView>(src)) {
+		value = src.cast<const GdPoolByteArrayView &>().array;
+	} else if (isinstance<GdPoolRealArrayView>(src)) {
+		value = src.cast<const GdPoolRealArrayView &>().array;
+	} else if (isinstance<GdPoolVector2ArrayView>(src)) {
+		value = src.cast<const GdPoolVector2ArrayView &>().array;
+	} else {
+		return false;
+	}
+	return true;
+}
+
+inline handle type_caster<Variant>::cast(const Variant &src, return_value_policy policy, handle parent) {
+	switch (src.get_type()) {
+		case Variant::NIL:
+			return none().release();
+		case Variant::BOOL:
+			return bool_(bool(src)).release();
+		case Variant::INT: {
+			const int64_t v = src;
+			return (v >= LONG_MIN && v <= LONG_MAX) ? PyInt_FromLong(long(v)) : PyLong_FromLongLong(v);
+		}
+		case Variant::REAL:
+			return PyFloat_FromDouble(double(src));
+		case Variant::STRING: {
+			const CharString s = String(src).utf8();
+			return PyString_FromStringAndSize(s.get_data(), s.length());
+		}
+		case Variant::VECTOR2:
+			return pybind11::cast(Vector2(src)).release();
+		case Variant::VECTOR3:
+			return pybind11::cast(Vector3(src)).release();
+		case Variant::RECT2:
+			return pybind11::cast(Rect2(src)).release();
+		case Variant::COLOR:
+			return pybind11::cast(Color(src)).release();
+		case Variant::ARRAY:
+			return type_caster<Array>::cast(Array(src), policy, parent);
+		case Variant::DICTIONARY:
+			return type_caster<Dictionary>::cast(Dictionary(src), policy, parent);
+		case Variant::POOL_BYTE_ARRAY:
+			return type_caster<PoolByteArray>::cast(PoolByteArray(src), policy, parent);
+		case Variant::POOL_REAL_ARRAY:
+			return type_caster<PoolRealArray>::cast(PoolRealArray(src), policy, parent);
+		case Variant::POOL_VECTOR2_ARRAY:
+			return type_caster<PoolVector2Array>::cast(PoolVector2Array(src), policy, parent);
+		case Variant::OBJECT: {
+			const Object *obj = src;
+			return obj ? PyInt_FromLong(long(obj->get_instance_id())) : none().release();
+		}
+		default: {
+			const CharString s = String(src).utf8();
+			return PyString_FromStringAndSize(s.get_data(), s.length());
+		}
+	}
+}
+
+} // namespace detail
+} // namespace pybind11
+
+#endif // PY_CASTERS_H
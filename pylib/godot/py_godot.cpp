@@ -21,8 +21,14 @@
 #include "default_bitmap.gen.h"
 #include "default_mono.gen.h"
 
+#include <atomic>
+#include <condition_variable>
 #include <iostream>
+#include <list>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <unordered_map>
 
 // Reference:
 // ----------
@@ -46,7 +52,133 @@ py::object py_eval(const char *expr, const py::object &o);
 py::object py_call(py::object p_obj, String p_func_name, py::args p_args = py::args());
 py::object py_call(String p_func_name, py::args p_args = py::args(), String p_module = "__main__");
 
-static std::map<std::tuple<std::string, int, int, int>, Ref<Font>> _font_cache;
+// Fonts created by GdFont, keyed by all creation parameters. Least recently
+// used fonts are released when estimated glyph atlas memory goes over the
+// budget (Godot does not expose DynamicFont atlases, so the size is derived
+// from font size, outline and number of glyphs of a typical Latin text).
+struct GdFontCache {
+	static const int GLYPHS_ESTIMATE = 128;
+	static const int ATLAS_MIN_BYTES = 256 * 256 * 2; // first LA8 atlas page
+
+	struct Key {
+		std::string path;
+		int size, outline_size, stretch;
+		uint32_t outline_color;
+
+		bool operator==(const Key &p_key) const {
+			return size == p_key.size && outline_size == p_key.outline_size && stretch == p_key.stretch && outline_color == p_key.outline_color && path == p_key.path;
+		}
+	};
+
+	struct KeyHash {
+		size_t operator()(const Key &p_key) const {
+			uint32_t h = hash_djb2(p_key.path.c_str());
+			h = hash_djb2_one_32(p_key.size, h);
+			h = hash_djb2_one_32(p_key.outline_size, h);
+			h = hash_djb2_one_32(p_key.stretch, h);
+			return hash_djb2_one_32(p_key.outline_color, h);
+		}
+	};
+
+	struct Entry {
+		Key key;
+		Ref<Font> font;
+		size_t bytes;
+	};
+
+	std::list<Entry> lru; // most recently used first
+	std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index;
+	std::vector<std::pair<ObjectID, size_t>> evicted_live; // evicted, still used by gdgame.font.Font objects
+	size_t budget = 16 * 1024 * 1024;
+	size_t bytes = 0;
+	uint64_t hits = 0, misses = 0, evictions = 0;
+
+	static Key make_key(const std::string &p_path, int p_size, int p_outline_size, const Color &p_outline_color, int p_stretch) {
+		// outline color does not matter without outline
+		return Key{ p_path, p_size, p_outline_size, p_stretch, p_outline_size > 0 ? p_outline_color.to_rgba32() : 0 };
+	}
+
+	static size_t estimate_bytes(const Key &p_key) {
+		const int cell = p_key.size + 2 * p_key.outline_size + 2; // glyph with padding
+		const size_t glyphs = size_t(cell) * cell * 2 * GLYPHS_ESTIMATE; // LA8
+		return MAX(glyphs, size_t(ATLAS_MIN_BYTES)) * (p_key.outline_size > 0 ? 2 : 1); // outline glyphs are separate
+	}
+
+	Ref<Font> get(const Key &p_key) {
+		auto it = index.find(p_key);
+		if (it == index.end()) {
+			misses++;
+			return Ref<Font>();
+		}
+		hits++;
+		lru.splice(lru.begin(), lru, it->second);
+		return it->second->font;
+	}
+
+	void put(const Key &p_key, const Ref<Font> &p_font) {
+		const size_t font_bytes = estimate_bytes(p_key);
+		lru.push_front(Entry{ p_key, p_font, font_bytes });
+		index[p_key] = lru.begin();
+		bytes += font_bytes;
+		trim();
+	}
+
+	// Evicted fonts still referenced keep their atlas: counted until released
+	size_t live_evicted_bytes() {
+		size_t live = 0;
+		for (size_t i = 0; i < evicted_live.size();) {
+			if (ObjectDB::get_instance(evicted_live[i].first)) {
+				live += evicted_live[i].second;
+				i++;
+			} else {
+				evicted_live[i] = evicted_live.back();
+				evicted_live.pop_back();
+			}
+		}
+		return live;
+	}
+
+	// Release fonts over the budget (the most recent one is always kept)
+	void trim() {
+		while (bytes > budget && lru.size() > 1) {
+			const Entry &e = lru.back();
+			bytes -= e.bytes;
+			if (e.font.is_valid() && e.font->get_reference_count() > 1) {
+				evicted_live.push_back(std::make_pair(e.font->get_instance_id(), e.bytes));
+			}
+			index.erase(e.key);
+			lru.pop_back();
+			evictions++;
+		}
+	}
+
+	void set_budget(size_t p_bytes) {
+		budget = p_bytes;
+		trim();
+	}
+
+	void clear() {
+		index.clear();
+		lru.clear();
+		evicted_live.clear();
+		bytes = 0;
+	}
+
+	py::dict get_stats() {
+		const uint64_t lookups = hits + misses;
+		const size_t evicted_bytes = live_evicted_bytes();
+		return py::dict(
+			"fonts"_a = lru.size(),
+			"atlas_bytes"_a = bytes + evicted_bytes,
+			"cached_bytes"_a = bytes,
+			"evicted_live_bytes"_a = evicted_bytes,
+			"budget"_a = budget,
+			"hits"_a = hits,
+			"misses"_a = misses,
+			"hit_rate"_a = lookups ? double(hits) / lookups : 0.0,
+			"evictions"_a = evictions);
+	}
+} _font_cache;
 
 static String get_full_version_string() {
 	static String _version;
@@ -60,47 +192,530 @@ static String get_full_version_string() {
 	return _version;
 }
 
+static const char *_callback_names[PyGodotInstance::CALLBACK_MAX] = {
+	"gd_init",
+	"gd_tick",
+	"gd_draw",
+	"gd_event",
+	"gd_events",
+	"gd_term",
+};
+
+// Convert callback result without going through pybind11 casters (steals the reference)
+static Variant _py_result_to_variant(PyObject *p_res) {
+	if (p_res == nullptr) {
+		PyErr_Print();
+		return Variant();
+	}
+	Variant ret;
+	if (p_res == Py_None) {
+		// nothing to convert
+	} else if (PyBool_Check(p_res)) {
+		ret = p_res == Py_True;
+	} else if (PyInt_Check(p_res)) {
+		ret = int(PyInt_AS_LONG(p_res));
+	} else if (PyFloat_Check(p_res)) {
+		ret = real_t(PyFloat_AS_DOUBLE(p_res));
+	} else if (PyString_Check(p_res)) {
+		ret = String(PyString_AS_STRING(p_res));
+	} else {
+		py::detail::make_caster<Variant> conv;
+		if (conv.load(p_res, true)) {
+			ret = py::detail::cast_op<Variant>(conv);
+		} else {
+			WARN_PRINT("Ignoring function return value");
+		}
+	}
+	Py_DECREF(p_res);
+	return ret;
+}
+
+// Python application ticking on its own thread (threaded mode)
+struct PyWorker {
+	std::thread thread;
+	std::mutex mutex;
+	std::condition_variable cond;
+	GdMainCalls calls{ mutex, cond }; // engine calls of the worker
+
+	bool quit = false;
+	bool pending = false; // tick requested by the main thread
+	bool busy = false; // worker is running Python code
+	bool ready = false; // back list holds a complete frame
+	bool first = true;
+	real_t delta = 0; // process time accumulated since the last tick
+	int latency = 1; // frames between tick and display
+
+	Object *instance = nullptr;
+	Size2 view_size; // of the instance, set with every tick
+	GdRenderQueue lists[2]; // front list is replayed, back list is recorded
+	int front = 0;
+
+	GdEventBuffer input; // events queued by the main thread
+};
+
+// Time budget of a single application callback: checked by the interpreter
+// every _Py_CheckInterval instructions (see _Py_PeriodicHook in ceval.c)
+struct PyFrameBudget {
+	uint64_t limit_usec = 0; // 0 - no limit
+	uint64_t deadline = 0;
+	bool fired = false; // FrameBudgetExceeded is raised once per callback
+
+	std::atomic<uint64_t> calls{ 0 };
+	std::atomic<uint64_t> overruns{ 0 }; // callbacks running longer than the budget
+	std::atomic<uint64_t> preempted{ 0 }; // callbacks interrupted with FrameBudgetExceeded
+	std::atomic<uint64_t> last_usec{ 0 };
+	std::atomic<uint64_t> max_usec{ 0 };
+};
+
+static PyObject *_frame_budget_exception = nullptr;
+static thread_local PyFrameBudget *_active_budget = nullptr;
+
+static PyObject *_get_frame_budget_exception() {
+	if (_frame_budget_exception == nullptr) {
+		_frame_budget_exception = PyErr_NewException((char *)"gdgame.FrameBudgetExceeded", PyExc_RuntimeError, nullptr);
+	}
+	return _frame_budget_exception;
+}
+
+static int _frame_budget_hook() {
+	PyFrameBudget *b = _active_budget;
+	if (b && !b->fired && OS::get_singleton()->get_ticks_usec() > b->deadline) {
+		b->fired = true;
+		PyErr_SetString(_frame_budget_exception, "Frame budget exceeded");
+		return -1;
+	}
+	return 0;
+}
+
+struct PyFrameBudgetScope {
+	PyFrameBudget *budget, *prev;
+	uint64_t start;
+
+	PyFrameBudgetScope(PyFrameBudget *p_budget) : budget(p_budget), prev(_active_budget), start(OS::get_singleton()->get_ticks_usec()) {
+		budget->deadline = start + budget->limit_usec;
+		budget->fired = false;
+		_active_budget = budget;
+	}
+	~PyFrameBudgetScope() {
+		_active_budget = prev;
+		const uint64_t elapsed = OS::get_singleton()->get_ticks_usec() - start;
+		budget->calls++;
+		budget->last_usec = elapsed;
+		if (elapsed > budget->max_usec) {
+			budget->max_usec = elapsed;
+		}
+		if (elapsed > budget->limit_usec) {
+			budget->overruns++;
+		}
+		if (budget->fired) {
+			budget->preempted++;
+		}
+	}
+};
+
+PyGodotGIL::PyGodotGIL() : _state(PyGILState_Ensure()) {
+}
+
+PyGodotGIL::~PyGodotGIL() {
+	PyGILState_Release(PyGILState_STATE(_state));
+}
+
 struct _attr_visibility_hidden PyGodotInstance::InstancePrivateData {
 	py::object py_app;
+
+	// bound methods of py_app, resolved in build_pygodot and
+	// re-validated only when the application object changes
+	PyObject *resolved_app = nullptr;
+	py::object callbacks[CALLBACK_MAX];
+	py::object args1; // preallocated single argument tuple
+
+	GdEventBuffer events; // queued input events (batch mode)
+	py::object events_obj;
+
+	PyFrameBudget budget;
+
+	GdScheduler sched; // coroutines of the application
+
+	int instance_id = 0;
+	GdRenderQueue draw_list; // recorded gd_draw (batched drawing)
+	GdRetainedCanvas retained; // layers of gd_draw (retained drawing)
+
+	std::unique_ptr<PyWorker> worker;
+
+	void resolve_callbacks() {
+		for (int c = 0; c < CALLBACK_MAX; c++) {
+			callbacks[c] = py::object();
+			if (py_app && !py_app.is_none() && PyObject_HasAttrString(py_app.ptr(), _callback_names[c])) {
+				callbacks[c] = py_app.attr(_callback_names[c]);
+			}
+		}
+		resolved_app = py_app.ptr();
+	}
+
+	_FORCE_INLINE_ PyObject *get_callback(Callback p_func) {
+		if (unlikely(py_app.ptr() != resolved_app)) {
+			resolve_callbacks();
+		}
+		return callbacks[p_func].ptr();
+	}
+
+	// Reuse argument tuple unless someone else is keeping a reference to it
+	_FORCE_INLINE_ PyObject *make_args(PyObject *p_arg) {
+		if (unlikely(!args1 || Py_REFCNT(args1.ptr()) != 1)) {
+			args1 = py::reinterpret_steal<py::object>(PyTuple_New(1));
+		}
+		PyObject *args = args1.ptr();
+		PyObject *prev = PyTuple_GET_ITEM(args, 0);
+		PyTuple_SET_ITEM(args, 0, p_arg); // steals p_arg
+		Py_XDECREF(prev);
+		return args;
+	}
+
+	// Setup and teardown callbacks are never preempted
+	_FORCE_INLINE_ Variant invoke(Callback p_func, PyObject *p_callable, PyObject *p_args) {
+		GdScheduler::Scope sched_scope(&sched);
+		if (budget.limit_usec == 0 || p_func == CALLBACK_INIT || p_func == CALLBACK_TERM) {
+			return _py_result_to_variant(PyObject_Call(p_callable, p_args, nullptr));
+		}
+		PyObject *res;
+		{
+			PyFrameBudgetScope scope(&budget);
+			res = PyObject_Call(p_callable, p_args, nullptr);
+		}
+		if (res == nullptr && PyErr_ExceptionMatches(_frame_budget_exception)) {
+			PyErr_Clear(); // not handled by the application: drop rest of the callback
+#ifdef DEBUG_ENABLED
+			print_verbose(vformat("(PyGodot) %s preempted after %d usec", _callback_names[p_func], budget.last_usec.load()));
+#endif
+			return Variant();
+		}
+		return _py_result_to_variant(res);
+	}
+
+	_FORCE_INLINE_ Variant call(Callback p_func) {
+		if (PyObject *func = get_callback(p_func)) {
+			static PyObject *_no_args = PyTuple_New(0);
+			return invoke(p_func, func, _no_args);
+		}
+		return Variant();
+	}
+
+	_FORCE_INLINE_ Variant call(Callback p_func, PyObject *p_arg) {
+		if (PyObject *func = get_callback(p_func)) {
+			return invoke(p_func, func, make_args(p_arg));
+		}
+		Py_XDECREF(p_arg);
+		return Variant();
+	}
+
+	void deliver_events() {
+		if (!events.empty() && !py_app.is_none()) {
+			if (get_callback(CALLBACK_EVENTS)) {
+				if (!events_obj) {
+					events_obj = py::cast(&events, py::return_value_policy::reference);
+				}
+				call(CALLBACK_EVENTS, events_obj.inc_ref().ptr());
+			} else {
+				// application without batch handler: deliver one by one
+				for (const auto &ev : events.records) {
+					call(CALLBACK_EVENT, py::cast(ev.to_event()).release().ptr());
+				}
+			}
+		}
+		events.clear();
+	}
+
+	void run_coroutines() {
+		GdScheduler::Scope sched_scope(&sched);
+		sched.run();
+	}
+
+	void worker_loop() {
+		PyWorker *w = worker.get();
+		PyGILState_STATE gstate = PyGILState_Ensure();
+		PyThreadState *tstate = PyEval_SaveThread(); // keep thread state between frames
+		GdMainCalls::current() = &w->calls;
+		Size2 view_size;
+		GdDisplaySurface::view_size() = &view_size;
+		std::unique_lock<std::mutex> lock(w->mutex);
+		while (true) {
+			w->cond.wait(lock, [w] { return w->pending || w->quit; });
+			if (w->quit) {
+				break;
+			}
+			const real_t delta = w->delta;
+			view_size = w->view_size;
+			GdRenderQueue &back = w->lists[1 - w->front];
+			events.take(w->input);
+			w->delta = 0;
+			w->pending = false;
+			w->busy = true;
+			lock.unlock();
+
+			bool drawn = false;
+			PyEval_RestoreThread(tstate);
+			deliver_events();
+			run_coroutines();
+			if (call(CALLBACK_TICK, PyFloat_FromDouble(delta)) || w->first) {
+				back.clear();
+				GdDisplaySurface::recorder() = &back;
+				call(CALLBACK_DRAW);
+				GdDisplaySurface::recorder() = nullptr;
+				w->first = false;
+				drawn = true;
+			}
+			tstate = PyEval_SaveThread();
+
+			lock.lock();
+			w->busy = false;
+			w->ready = w->ready || drawn;
+			w->cond.notify_all();
+		}
+		lock.unlock();
+		GdDisplaySurface::view_size() = nullptr;
+		GdMainCalls::current() = nullptr;
+		PyEval_RestoreThread(tstate);
+		PyGILState_Release(gstate);
+	}
+
+	void reset() {
+		for (int c = 0; c < CALLBACK_MAX; c++) {
+			callbacks[c] = py::object();
+		}
+		args1 = py::object();
+		sched.clear();
+		retained.clear();
+		events.clear();
+		events_obj = py::object();
+		resolved_app = nullptr;
+		py_app = py::none();
+	}
 };
 
+const char *PyGodotInstance::get_callback_name(Callback p_func) {
+	ERR_FAIL_INDEX_V(p_func, CALLBACK_MAX, "");
+	return _callback_names[p_func];
+}
+
 PyGodotInstance::PyGodotInstance() : _p(memnew(InstancePrivateData)) {
 }
 
 PyGodotInstance::~PyGodotInstance() {
 	if (_p) {
-		memdelete(_p);
+		stop_thread();
+		if (Py_IsInitialized()) {
+			PyGodotGIL gil;
+			memdelete(_p);
+		} else {
+			memdelete(_p);
+		}
 	}
 }
 
-bool PyGodotInstance::process_events(const Ref<InputEvent> &p_event, const String &p_event_func) {
+static bool _convert_event(const Ref<InputEvent> &p_event, GdEventRecord &r_ev) {
+	if (const InputEventMouseMotion *m = Object::cast_to<InputEventMouseMotion>(*p_event)) {
+		const Point2 pos = m->get_position();
+		r_ev = GdEventRecord{GdEvent::MOUSEMOTION, pos.x, pos.y, 0, 0, 0};
+		return true;
+	}
+	if (const InputEventMouseButton *mb = Object::cast_to<InputEventMouseButton>(*p_event)) {
+		const Point2 pos = mb->get_position();
+		r_ev = GdEventRecord{mb->is_pressed() ? GdEvent::MOUSEBUTTONDOWN : GdEvent::MOUSEBUTTONUP, pos.x, pos.y, mb->get_button_index(), 0, 0};
+		return true;
+	}
+	if (const InputEventKey *mk = Object::cast_to<InputEventKey>(*p_event)) {
+		r_ev = GdEventRecord{mk->is_pressed() ? GdEvent::KEYDOWN : GdEvent::KEYUP, 0, 0, 0, int32_t(mk->get_scancode()), mk->get_unicode()};
+		return true;
+	}
+	return false;
+}
+
+bool PyGodotInstance::process_events(const Ref<InputEvent> &p_event) {
 	if (!_p->py_app.is_none()) {
-		if (const InputEventMouseMotion *m = Object::cast_to<InputEventMouseMotion>(*p_event)) {
-			GdEvent ev{GdEvent::MOUSEMOTION};
-			ev.position = m->get_position();
-			py_call(_p->py_app, p_event_func, py::make_tuple(ev));
-			return true;
-		}
-		if (const InputEventMouseButton *mb = Object::cast_to<InputEventMouseButton>(*p_event)) {
-			GdEvent ev{mb->is_pressed() ? GdEvent::MOUSEBUTTONDOWN : GdEvent::MOUSEBUTTONUP};
-			ev.position = mb->get_position();
-			ev.button = mb->get_button_index();
-			py_call(_p->py_app, p_event_func, py::make_tuple(ev));
+		PyGodotGIL gil;
+		GdEventRecord ev;
+		if (_convert_event(p_event, ev)) {
+			_p->call(CALLBACK_EVENT, py::cast(ev.to_event()).release().ptr());
 			return true;
 		}
-		if (const InputEventKey *mk = Object::cast_to<InputEventKey>(*p_event)) {
-			GdEvent ev{mk->is_pressed() ? GdEvent::KEYDOWN : GdEvent::KEYUP};
-			ev.key = mk->get_scancode();
-			ev.unicode = mk->get_unicode();
-			py_call(_p->py_app, p_event_func, py::make_tuple(ev));
+	}
+	return false;
+}
+
+bool PyGodotInstance::queue_events(const Ref<InputEvent> &p_event, bool p_coalesce_motion) {
+	if (!_p->py_app.is_none()) {
+		GdEventRecord ev;
+		if (_convert_event(p_event, ev)) {
+			if (PyWorker *w = _p->worker.get()) {
+				std::lock_guard<std::mutex> lock(w->mutex);
+				w->input.push(ev, p_coalesce_motion);
+			} else {
+				_p->events.push(ev, p_coalesce_motion);
+			}
 			return true;
 		}
 	}
 	return false;
 }
 
+void PyGodotInstance::flush_events() {
+	if (!_p->events.empty()) {
+		PyGodotGIL gil;
+		_p->deliver_events();
+	}
+}
+
+bool PyGodotInstance::start_thread(int p_instance_id, int p_latency) {
+	ERR_FAIL_COND_V(_p->worker, false);
+	ERR_FAIL_COND_V(_p->py_app.is_none(), false);
+
+	CPythonEngine::get_singleton()->release_main_thread(); // main thread takes the lock on demand from now
+
+	_p->worker = std::make_unique<PyWorker>();
+	_p->worker->instance = ObjectDB::get_instance(p_instance_id);
+	_p->worker->latency = CLAMP(p_latency, 0, 1);
+	_p->worker->thread = std::thread(&InstancePrivateData::worker_loop, _p);
+	return true;
+}
+
+void PyGodotInstance::stop_thread() {
+	if (PyWorker *w = _p->worker.get()) {
+		{
+			std::unique_lock<std::mutex> lock(w->mutex);
+			w->quit = true;
+			w->cond.notify_all();
+			w->calls.wait(lock, [w] { return !w->busy; }); // frame in progress may need the main thread
+		}
+		w->thread.join();
+		_p->worker.reset();
+	}
+}
+
+bool PyGodotInstance::is_threaded() const {
+	return bool(_p->worker);
+}
+
+bool PyGodotInstance::sync_thread(real_t p_delta) {
+	PyWorker *w = _p->worker.get();
+	ERR_FAIL_NULL_V(w, false);
+	const Size2 view_size = w->instance->call("get_view_size");
+	std::unique_lock<std::mutex> lock(w->mutex);
+	w->delta += p_delta;
+	w->view_size = view_size;
+	if (w->latency == 0) {
+		// no latency: tick now and wait for the frame
+		w->pending = true;
+		w->cond.notify_all();
+		w->calls.wait(lock, [w] { return !w->busy && !w->pending; });
+	} else {
+		w->calls.run_posted(lock); // worker waiting for the main thread
+		if (w->busy || w->pending) {
+			return false; // still working on the previous frame
+		}
+	}
+	bool redraw = false;
+	if (w->ready) {
+		w->front = 1 - w->front;
+		w->ready = false;
+		redraw = true;
+	}
+	if (w->latency > 0) {
+		// start next frame while engine is rendering this one
+		w->pending = true;
+		w->cond.notify_all();
+	}
+	return redraw;
+}
+
+void PyGodotInstance::draw_batched() {
+	if (!_p->py_app.is_none()) {
+		{
+			PyGodotGIL gil;
+			_p->draw_list.clear();
+			GdDisplaySurface::recorder() = &_p->draw_list;
+			_p->call(CALLBACK_DRAW);
+			GdDisplaySurface::recorder() = nullptr;
+		}
+		GdDisplaySurface(_p->instance_id).render_queue(_p->draw_list);
+	}
+}
+
+void PyGodotInstance::draw_retained() {
+	if (!_p->py_app.is_none()) {
+		CanvasItem *canvas = Object::cast_to<CanvasItem>(ObjectDB::get_instance(_p->instance_id));
+		ERR_FAIL_NULL(canvas);
+		{
+			PyGodotGIL gil;
+			_p->retained.begin(canvas->get_canvas_item());
+			_p->call(CALLBACK_DRAW);
+		}
+		_p->retained.end(); // re-emit changed layers only
+	}
+}
+
+void PyGodotInstance::draw_thread() {
+	PyWorker *w = _p->worker.get();
+	ERR_FAIL_NULL(w);
+	{
+		std::unique_lock<std::mutex> lock(w->mutex);
+		w->calls.run_posted(lock);
+	}
+	GdDisplaySurface(w->instance).render_queue(w->lists[w->front]);
+}
+
+void PyGodotInstance::run_coroutines() {
+	if (!_p->py_app.is_none() && _p->sched.count() > 0) {
+		PyGodotGIL gil;
+		_p->run_coroutines();
+	}
+}
+
+void PyGodotInstance::resume_coroutines(int p_instance_id, const String &p_signal) {
+	_p->sched.wake(p_instance_id, p_signal.utf8().get_data());
+}
+
+void PyGodotInstance::set_frame_budget(uint64_t p_usec) {
+	if (p_usec > 0) {
+		_Py_PeriodicHook = _frame_budget_hook; // exception object is created with the application
+	}
+	_p->budget.limit_usec = p_usec;
+}
+
+uint64_t PyGodotInstance::get_frame_budget() const {
+	return _p->budget.limit_usec;
+}
+
+Dictionary PyGodotInstance::get_budget_stats() const {
+	Dictionary stats;
+	stats["calls"] = _p->budget.calls.load();
+	stats["overruns"] = _p->budget.overruns.load();
+	stats["preempted"] = _p->budget.preempted.load();
+	stats["last_usec"] = _p->budget.last_usec.load();
+	stats["max_usec"] = _p->budget.max_usec.load();
+	return stats;
+}
+
+Variant PyGodotInstance::pycall(Callback p_func, real_t p_arg) {
+	ERR_FAIL_INDEX_V(p_func, CALLBACK_MAX, Variant());
+	if (!_p->py_app.is_none()) {
+		PyGodotGIL gil;
+		return _p->call(p_func, PyFloat_FromDouble(p_arg));
+	}
+	return Variant();
+}
+
+Variant PyGodotInstance::pycall(Callback p_func) {
+	ERR_FAIL_INDEX_V(p_func, CALLBACK_MAX, Variant());
+	if (!_p->py_app.is_none()) {
+		PyGodotGIL gil;
+		return _p->call(p_func);
+	}
+	return Variant();
+}
+
 Variant PyGodotInstance::pycall(const String &p_func, real_t p_arg) {
 	if (!_p->py_app.is_none()) {
+		PyGodotGIL gil;
 		auto r = py_call(_p->py_app, p_func, py::make_tuple(p_arg));
 		if (!r.is_none()) {
 			if (py::isinstance<py::bool_>(r)) {
@@ -123,6 +738,7 @@ Variant PyGodotInstance::pycall(const String &p_func, real_t p_arg) {
 
 Variant PyGodotInstance::pycall(const String &p_func) {
 	if (!_p->py_app.is_none()) {
+		PyGodotGIL gil;
 		auto r = py_call(_p->py_app, p_func);
 		if (!r.is_none()) {
 			if (py::isinstance<py::bool_>(r)) {
@@ -144,16 +760,26 @@ Variant PyGodotInstance::pycall(const String &p_func) {
 }
 
 bool PyGodotInstance::build_pygodot(int p_instance_id, const String &p_build_func) {
+	PyGodotGIL gil;
 	_p->py_app = py_call(p_build_func, py::make_tuple(p_instance_id));
+	_p->resolve_callbacks();
+	_p->instance_id = _p->sched.instance_id = p_instance_id;
+	_get_frame_budget_exception();
 	return (!_p->py_app.is_none());
 }
 
 void PyGodotInstance::destroy_pygodot() {
+	stop_thread();
 	if (!_p->py_app.is_none()) {
-		_p->py_app = py::none();
+		PyGodotGIL gil;
+		_p->reset();
 		py::module_::import("gc").attr("collect")();
 		// clear global data:
 		_font_cache.clear();
+		_text_cache.clear();
+		_label_baker.clear();
+		_atlas.clear();
+		_loader.stop();
 		py::print("*** Application is closing.");
 	}
 }
@@ -164,9 +790,10 @@ void PyGodotInstance::destroy_pygodot() {
 #ifdef MODULE_FREETYPE_ENABLED
 static Ref<Font> _get_default_dynamic_font(int size, int outline_size, Color outline_color, int stretch) {
 	static Ref<DynamicFontData> default_font_data;
-	std::tuple<std::string, int, int, int> key = std::make_tuple("__default__", size, stretch, outline_size);
-	if (_font_cache.count(key)) {
-		return _font_cache[key];
+	const GdFontCache::Key key = GdFontCache::make_key("__default__", size, outline_size, outline_color, stretch);
+	Ref<Font> cached = _font_cache.get(key);
+	if (cached.is_valid()) {
+		return cached;
 	}
 	if (default_font_data.is_null()) {
 		default_font_data.instance();
@@ -183,14 +810,15 @@ static Ref<Font> _get_default_dynamic_font(int size, int outline_size, Color out
 		font->set_outline_size(outline_size);
 		font->set_outline_color(outline_color);
 	}
-	_font_cache[key] = font;
+	_font_cache.put(key, font);
 	return font;
 }
 
 static Ref<Font> _get_dynamic_font(const std::string &path, int size, int outline_size, Color outline_color, int stretch) {
-	std::tuple<std::string, int, int, int> key = std::make_tuple(path, size, stretch, outline_size);
-	if (_font_cache.count(key)) {
-		return _font_cache[key];
+	const GdFontCache::Key key = GdFontCache::make_key(path, size, outline_size, outline_color, stretch);
+	Ref<Font> cached = _font_cache.get(key);
+	if (cached.is_valid()) {
+		return cached;
 	}
 	Ref<DynamicFont> font = memnew(DynamicFont);
 	font->set_font_data(ResourceLoader::load(path.c_str()));
@@ -202,7 +830,7 @@ static Ref<Font> _get_dynamic_font(const std::string &path, int size, int outlin
 		font->set_outline_size(outline_size);
 		font->set_outline_color(outline_color);
 	}
-	_font_cache[key] = font;
+	_font_cache.put(key, font);
 	return font;
 }
 
@@ -364,6 +992,12 @@ void GdSound::stop() { }
 
 
 bool GdFont::load(const std::string &path, int size, int outline_size, Color outline_color, int stretch) {
+	bool loaded = false;
+	GdMainCalls::run([&] { loaded = _load(path, size, outline_size, outline_color, stretch); }); // resources and font caches
+	return loaded;
+}
+
+bool GdFont::_load(const std::string &path, int size, int outline_size, Color outline_color, int stretch) {
 	if (path.empty() || path == "_") {
 #ifdef MODULE_FREETYPE_ENABLED
 		font = _get_default_dynamic_font(size, outline_size, outline_color, stretch);
@@ -410,6 +1044,29 @@ bool GdFont::load(const std::string &path, int size, int outline_size, Color out
 	return font.is_valid();
 }
 
+py::object GdLoadFuture::result() {
+	if (value) {
+		return value;
+	}
+	wait(-1);
+	if (failed()) {
+		PyErr_SetString(PyExc_IOError, ("Failed to load in background: " + state->path).utf8().get_data());
+		throw py::error_already_set();
+	}
+	if (kind == IMAGE) {
+		Ref<Texture> texture = state->resource;
+		GdMainCalls::run([&] { texture = _atlas.pack(state->path, texture); }); // main thread only
+		value = py::cast(GdSurface(std::make_unique<GdTextureSurface>(texture)));
+	} else {
+		// loaded font data is found in the resource cache
+		GdFont font;
+		font.load(path, size, outline_size, outline_color, stretch);
+		value = py::cast(std::move(font));
+	}
+	state->resource.unref();
+	return value;
+}
+
 // END
 
 // BEGIN Python bindings
@@ -418,6 +1075,9 @@ bool GdFont::load(const std::string &path, int size, int outline_size, Color out
 //  +--core
 //     +-String
 //     +-Dict
+//     +-PoolByteArray
+//     +-PoolRealArray
+//     +-PoolVector2Array
 //     +-Vector2
 //     +-Vector3
 //     +-Rect2
@@ -429,6 +1089,7 @@ bool GdFont::load(const std::string &path, int size, int outline_size, Color out
 //  +--mouse
 //  +--joystick
 //  +--event
+//  +--sched
 //  +--display
 //  +--image
 //  +--draw
@@ -438,11 +1099,49 @@ bool GdFont::load(const std::string &path, int size, int outline_size, Color out
 //  +--net
 //
 
+// pybind11 only frees its buffer_info when a view is released, types
+// counting their exported views get release_buffer() called too
+template <typename T>
+static void _track_buffer_release(const py::handle &type) {
+	((PyHeapTypeObject *)type.ptr())->as_buffer.bf_releasebuffer = [](PyObject *obj, Py_buffer *view) {
+		py::handle(obj).cast<T &>().release_buffer();
+		delete (py::buffer_info *)view->internal;
+	};
+}
+
+template <typename T>
+static void _bind_pool_array(py::module &m, const char *name) {
+	typedef GdPoolArrayView<T> View;
+	py::class_<View>(m, name, py::buffer_protocol())
+		.def(py::init<int>())
+		.def_buffer([](View &v) -> py::buffer_info { return _pool_buffer_info(v); })
+		.def_readonly("writable", &View::writable)
+		.def("__len__", &View::size)
+		.def("__getitem__", [](const View &v, int index) { return v.at(index); })
+		.def("__setitem__", [](View &v, int index, const T &value) { v.set(index, value); })
+		.def("__repr__", [name](const View &v) { return std::str(vformat("%s(%d)", name, v.size())); })
+		.attr("__version__") = VERSION_FULL_CONFIG;
+	py::object type = m.attr(name);
+	// refused before the buffer is created (and the pool locked)
+	((PyHeapTypeObject *)type.ptr())->as_buffer.bf_getbuffer = [](PyObject *obj, Py_buffer *view, int flags) {
+		if ((flags & PyBUF_WRITABLE) == PyBUF_WRITABLE && !py::handle(obj).cast<const View &>().writable) {
+			if (view) {
+				view->obj = nullptr;
+			}
+			PyErr_SetString(PyExc_BufferError, "Writable buffer requested for read-only pool array");
+			return -1;
+		}
+		return py::detail::pybind11_getbuffer(obj, view, flags);
+	};
+	_track_buffer_release<View>(type);
+}
+
 PYBIND11_EMBEDDED_MODULE(gdgame, m) {
 	m.doc() = "Godot bindings";
 	// gdgame
 	m.def("init", []() { });
 	m.def("quit", []() { });
+	m.attr("FrameBudgetExceeded") = py::handle(_get_frame_budget_exception());
 	// gdgame.utils
 	py::module m_utils = m.def_submodule("utils", "gdgame module with different utilities.");
 	m_utils.def("get_text", &utils::get_text);
@@ -452,6 +1151,26 @@ PYBIND11_EMBEDDED_MODULE(gdgame, m) {
 	m_utils.def("lin_ipol", &utils::lin_ipol, "value"_a, "a"_a, "b"_a, "begin"_a = 0, "end"_a = 1.0);
 	m_utils.def("get_instance_size", &utils::get_instance_size);
 	m_utils.def("quit", &utils::quit);
+	m_utils.def("get_stat_cache_stats", []() {
+		unsigned long long probes = 0, hits = 0;
+		size_t entries = 0;
+		_gd_stat_cache_info(&probes, &hits, &entries);
+		py::dict stats;
+		stats["probes"] = probes;
+		stats["hits"] = hits;
+		stats["entries"] = entries;
+		return stats;
+	});
+	m_utils.def("invalidate_stat_cache", []() { _gd_stat_cache_invalidate(); });
+	py::class_<GdMappedFile>(m_utils, "MappedFile", py::buffer_protocol())
+		.def(py::init<const std::string&>())
+		.def_buffer([](GdMappedFile &f) -> py::buffer_info {
+			return py::buffer_info((void *)f.data, 1, py::format_descriptor<uint8_t>::format(), ssize_t(f.size), true);
+		})
+		.def_property_readonly("mapped", &GdMappedFile::is_mapped)
+		.def("__len__", [](const GdMappedFile &f) { return f.size; })
+		.def("__repr__", [](const GdMappedFile &f) { return std::str(vformat("MappedFile(%d, %s)", int64_t(f.size), f.is_mapped() ? "mapped" : "copied")); })
+		.attr("__version__") = VERSION_FULL_CONFIG;
 	// gdgame.math
 	py::module m_math = m.def_submodule("math", "gdgame module with math definitions.");
 	m_math.def("sin", static_cast<real_t (*)(real_t)>(&Math::sin));
@@ -536,18 +1255,22 @@ PYBIND11_EMBEDDED_MODULE(gdgame, m) {
 		.def("__repr__", [](const String &s) { return std::str(s); })
 		.def("__copy__", [](const String &s){ return String(s); })
 		.attr("__version__") = VERSION_FULL_CONFIG;
-	py::class_<Dictionary>(m_core, "Dict")
-		.def("size", &Dictionary::size)
-		.def("has", [](const Dictionary &v, int index) { return v.has(index); })
-		.def("has", [](const Dictionary &v, const std::string &index) { return v.has(index.c_str()); })
-		.def("erase", [](Dictionary &v, int index) { return v.erase(index); })
-		.def("erase", [](Dictionary &v, const std::string &index) { return v.erase(index.c_str()); })
-		.def("clear", &Dictionary::clear)
-		.def("__repr__", [](const Dictionary &d) { return std::str(vformat("%s", d)); })
-		.def("__copy__", [](const Dictionary &d){ return Dictionary(d); })
-		.def("__getitem__", [](const Dictionary &v, int index) { return v[index]; })
-		.def("__getitem__", [](const Dictionary &v, const std::string &index) { return v[index.c_str()]; })
-		.attr("__version__") = VERSION_FULL_CONFIG;
+	// Dictionary is converted to dict: Dict subclass keeps methods of the former wrapper
+	py::object dict_type = py::reinterpret_steal<py::object>(PyObject_CallFunction((PyObject *)&PyType_Type, (char *)"s(O){s:s}", "Dict", &PyDict_Type, "__module__", "gdgame.core"));
+	dict_type.attr("size") = py::cpp_function([](const py::dict &d) { return d.size(); }, py::name("size"), py::is_method(dict_type));
+	dict_type.attr("has") = py::cpp_function([](const py::dict &d, const py::object &key) { return d.contains(key); }, py::name("has"), py::is_method(dict_type));
+	dict_type.attr("erase") = py::cpp_function([](const py::dict &d, const py::object &key) {
+		if (!d.contains(key)) {
+			return false;
+		}
+		PyDict_DelItem(d.ptr(), key.ptr());
+		return true;
+	}, py::name("erase"), py::is_method(dict_type));
+	m_core.attr("Dict") = dict_type;
+	py::detail::_gd_dict_type() = dict_type.inc_ref();
+	_bind_pool_array<uint8_t>(m_core, "PoolByteArray");
+	_bind_pool_array<real_t>(m_core, "PoolRealArray");
+	_bind_pool_array<Vector2>(m_core, "PoolVector2Array");
 	py::class_<Vector2>(m_core, "Vector2")
 		.def(py::init<real_t, real_t>())
 		.def_readwrite("x", &Vector2::x)
@@ -769,7 +1492,7 @@ PYBIND11_EMBEDDED_MODULE(gdgame, m) {
 		.def("__repr__", [](const Color &c) { return std::str(vformat("Color%s", c)); })
 		.def("__getitem__", [](const Color &c, int index) { return c[index]; })
 		.attr("__version__") = VERSION_FULL_CONFIG;
-	py::class_<GdSurface>(m, "Surface")
+	py::class_<GdSurface>(m, "Surface", py::buffer_protocol())
 		.def(py::init<real_t, real_t>())
 		.def(py::init<std::vector<real_t>>())
 		.def("get_width", &GdSurface::get_width)
@@ -778,20 +1501,41 @@ PYBIND11_EMBEDDED_MODULE(gdgame, m) {
 		.def_property_readonly("width", &GdSurface::get_width)
 		.def_property_readonly("height", &GdSurface::get_height)
 		.def_property_readonly("size", &GdSurface::get_size)
-		.def("fill", &GdSurface::fill)
+		.def("fill", overload_cast_<const std::vector<uint8_t>&>()(&GdSurface::fill))
+		.def("fill", overload_cast_<const std::vector<uint8_t>&, const std::vector<real_t>&>()(&GdSurface::fill))
+		.def("get_at", &GdSurface::get_at)
+		.def("set_at", &GdSurface::set_at)
+		.def("set_colorkey", &GdSurface::set_colorkey, "color"_a = py::none())
+		.def("get_colorkey", &GdSurface::get_colorkey)
+		.def("set_palette", &GdSurface::set_palette)
+		.def("blit_indices", &GdSurface::blit_indices)
+		.def_buffer([](GdSurface &s) -> py::buffer_info {
+			if (s.get_surface_type() != GdSurfaceImpl::IMAGE_SURFACE) {
+				throw py::type_error("Only image surfaces have pixel buffer");
+			}
+			GdImageSurface *surf = s.get_as_image();
+			surf->views++; // dirty until released, writes are not tracked
+			return py::buffer_info(surf->pixels.data(), sizeof(uint8_t), py::format_descriptor<uint8_t>::format(), 3,
+					{ ssize_t(surf->surf_height), ssize_t(surf->surf_width), ssize_t(4) },
+					{ ssize_t(surf->surf_width * 4), ssize_t(4), ssize_t(1) });
+		})
 		.def("blit", overload_cast_<GdSurface&, const std::vector<real_t>&>()(&GdSurface::blit)) // pos
 		.def("blit", overload_cast_<GdSurface&, const std::vector<real_t>&, const std::vector<real_t>&>()(&GdSurface::blit)) // pos + rect
 		.def("blit", overload_cast_<GdSurface&, const std::vector<real_t>&, const Rect2&>()(&GdSurface::blit)) // pos + dest + rect
+		.def("bake", &GdSurface::bake)
+		.def_property_readonly("baked", &GdSurface::is_baked)
 		.def("__repr__", [](const GdSurface &s) {
 			switch(s.impl->get_surface_type()) {
 				case GdSurfaceImpl::DISPLAY_SURFACE: return std::str(vformat("GdSurface 0x%0x {DISPLAY_SURFACE}", int64_t(&s)));
 				case GdSurfaceImpl::COLOR_SURFACE: return std::str(vformat("GdSurface 0x%0x {COLOR_SURFACE, %s}", int64_t(&s), *s.get_as_color()->surf_color));
 				case GdSurfaceImpl::TEXT_SURFACE: return std::str(vformat("GdSurface 0x%0x {TEXT_SURFACE, '%s'}", int64_t(&s), s.get_as_text()->text));
 				case GdSurfaceImpl::TEXTURE_SURFACE: return std::str(vformat("GdSurface 0x%0x {TEXTURE_SURFACE}", int64_t(&s)));
+				case GdSurfaceImpl::IMAGE_SURFACE: return std::str(vformat("GdSurface 0x%0x {IMAGE_SURFACE, %dx%d}", int64_t(&s), s.get_width(), s.get_height()));
 			}
 			return std::str(vformat("GdSurface 0x%0x {Unknown type: %d}", int64_t(&s), s.impl->get_surface_type()));
 		})
 		.attr("__version__") = VERSION_FULL_CONFIG;
+	_track_buffer_release<GdSurface>(m.attr("Surface"));
 	// gdgame.info
 	py::module m_info = m.def_submodule("info", "System and build info.");
 #ifdef DEBUG_ENABLED
@@ -931,6 +1675,13 @@ PYBIND11_EMBEDDED_MODULE(gdgame, m) {
 	// gdgame.time
 	py::module m_time = m.def_submodule("time", "gdgame module for monitoring time.");
 	m_time.def("get_ticks", []() { return OS::get_singleton()->get_ticks_msec(); });
+	m_time.def("get_budget_left", []() -> int64_t {
+		// usec left in the running callback budget (-1 if there is no limit)
+		if (PyFrameBudget *b = _active_budget) {
+			return MAX(int64_t(b->deadline) - int64_t(OS::get_singleton()->get_ticks_usec()), int64_t(0));
+		}
+		return -1;
+	});
 	// gdgame.event
 	py::module m_event = m.def_submodule("event", "gdgame module for interacting with events and queues.");
 	py::class_<GdEvent>(m_event, "Event")
@@ -942,7 +1693,58 @@ PYBIND11_EMBEDDED_MODULE(gdgame, m) {
 		.def("get_pos", [](const GdEvent &e) { return Point2(e.position); })
 		.def("update", []() { })
 		.attr("__version__") = VERSION_FULL_CONFIG;
+	py::class_<GdEventBuffer>(m_event, "EventBuffer", py::buffer_protocol())
+		.def_buffer([](GdEventBuffer &b) -> py::buffer_info {
+			// storage stays valid until the view is released (see _detach)
+			return py::buffer_info((void *)b.export_records(), 1, py::format_descriptor<uint8_t>::format(), ssize_t(b.records.size() * sizeof(GdEventRecord)), true);
+		})
+		.def("__len__", &GdEventBuffer::size)
+		.def_readonly("frame", &GdEventBuffer::frame)
+		.def_readonly("coalesced", &GdEventBuffer::coalesced)
+		.def("type", [](const GdEventBuffer &b, int index) { return b.at(index).type; })
+		.def("pos", [](const GdEventBuffer &b, int index) { return std::make_tuple(b.at(index).x, b.at(index).y); })
+		.def("button", [](const GdEventBuffer &b, int index) { return b.at(index).button; })
+		.def("key", [](const GdEventBuffer &b, int index) { return b.at(index).key; })
+		.def("unicode", [](const GdEventBuffer &b, int index) { return b.at(index).unicode; })
+		.def("get_event", [](const GdEventBuffer &b, int index) { return b.at(index).to_event(); })
+		.def_property_readonly_static("RECORD_FORMAT", [](const py::object&) { return GdEventBuffer::RECORD_FORMAT; })
+		.def_property_readonly_static("RECORD_SIZE", [](const py::object&) { return sizeof(GdEventRecord); })
+		.attr("__version__") = VERSION_FULL_CONFIG;
+	_track_buffer_release<GdEventBuffer>(m_event.attr("EventBuffer"));
 	m_event.def("set_grab", &event::set_grab);
+	// gdgame.sched
+	py::module m_sched = m.def_submodule("sched", "gdgame module for running generators as coroutines.");
+	py::class_<GdWait>(m_sched, "Wait")
+		.def_readonly("type", &GdWait::type)
+		.def_readonly("frames", &GdWait::frames)
+		.def_readonly("seconds", &GdWait::seconds)
+		.def("__repr__", [](const GdWait &w) { return std::str(vformat("Wait(%d, %d, %f, '%s')", w.type, w.frames, w.seconds, w.signal.c_str())); })
+		.attr("__version__") = VERSION_FULL_CONFIG;
+	m_sched.def("start", &sched::start);
+	m_sched.def("stop", &sched::stop);
+	m_sched.def("count", &sched::count);
+	m_sched.def("wait_frames", &sched::wait_frames, "frames"_a = 1);
+	m_sched.def("wait_seconds", &sched::wait_seconds);
+	m_sched.def("wait_signal", &sched::wait_signal);
+	py::class_<GdLoadFuture>(m_sched, "Future")
+		.def_property_readonly("path", [](const GdLoadFuture &f) { return f.path; })
+		.def_property_readonly("progress", &GdLoadFuture::progress)
+		.def_property_readonly("status", &GdLoadFuture::status)
+		.def("done", &GdLoadFuture::done)
+		.def("failed", &GdLoadFuture::failed)
+		.def("cancel", &GdLoadFuture::cancel)
+		.def("wait", &GdLoadFuture::wait, "timeout"_a = -1)
+		.def("result", &GdLoadFuture::result)
+		.def("__repr__", [](const GdLoadFuture &f) { return std::str(vformat("Future('%s', %d, %f)", f.path.c_str(), f.status(), f.progress())); })
+		.attr("__version__") = VERSION_FULL_CONFIG;
+	m_sched.attr("LOAD_PENDING") = int(GdLoadFuture::PENDING);
+	m_sched.attr("LOAD_LOADING") = int(GdLoadFuture::LOADING);
+	m_sched.attr("LOAD_DONE") = int(GdLoadFuture::DONE);
+	m_sched.attr("LOAD_FAILED") = int(GdLoadFuture::FAILED);
+	m_sched.def("get_loader_stats", []() { return _loader.get_stats(); });
+	m.attr("wait_frames") = m_sched.attr("wait_frames");
+	m.attr("wait_seconds") = m_sched.attr("wait_seconds");
+	m.attr("wait_signal") = m_sched.attr("wait_signal");
 	// gdgame.mouse
 	py::module m_mouse = m.def_submodule("mouse", "gdgame module to work with the mouse.");
 	m_mouse.def("set_visible", [](bool visible) {
@@ -1010,6 +1812,12 @@ PYBIND11_EMBEDDED_MODULE(gdgame, m) {
 	m_display.def("get_surface", &display::get_surface);
 	m_display.def("flip", &display::flip);
 	m_display.def("render_stats", &display::render_stats);
+	m_display.def("get_render_stats", &display::get_render_stats);
+	m_display.def("get_surface_stats", &display::get_surface_stats);
+	m_display.def("set_batching", &display::set_batching);
+	m_display.def("set_auto_bake", &display::set_auto_bake);
+	m_display.def("layer", &display::layer);
+	m_display.def("keep_layer", &display::keep_layer);
 	// gdgame.draw
 	py::module m_draw = m.def_submodule("draw", "gdgame module for drawing shapes.");
 	m_draw.def("rect", overload_cast_<const GdSurface&, const Color&, const Rect2&, int>()(&draw::rect));
@@ -1018,10 +1826,17 @@ PYBIND11_EMBEDDED_MODULE(gdgame, m) {
 	m_draw.def("rect", overload_cast_<const GdSurface&, int, const Rect2&, int>()(&draw::rect));
 	m_draw.def("style_rect", overload_cast_<const GdSurface&, const Color&, const Rect2&, int, int, const Color&, int, const Color&, const Vector2&>()(&draw::style_rect), "surf"_a, "color"_a, "rect"_a, "width"_a = 3, "radius"_a = 4, "bg_color"_a = Color::named("lightyellow"), "shadow_size"_a = 2, "shadow_color"_a = Color::named("black"), "shadow_offset"_a = Vector2(2,2));
 	m_draw.def("style_rect", overload_cast_<const GdSurface&, const std::vector<uint8_t>&, const std::vector<float>&, int, int, const std::vector<uint8_t>&, int, const std::vector<uint8_t>&, const std::vector<float>&>()(&draw::style_rect), "surf"_a, "color"_a, "rect"_a, "width"_a = 3, "radius"_a = 4, "bg_color"_a = py::make_tuple(255,255,224), "shadow_size"_a = 2, "shadow_color"_a = py::make_tuple(0,0,0), "shadow_offset"_a = py::make_tuple(2,2));
+	m_draw.def("sprites", &draw::sprites, "surf"_a, "image"_a, "buffer"_a, "components"_a = 2);
+	m_draw.def("sprite_regions", &draw::sprite_regions, "surf"_a, "image"_a, "buffer"_a, "components"_a = 6);
 	// gdgame.image
 	py::module m_image = m.def_submodule("image", "gdgame module for image transfer.");
 	m_image.def("load", &image::load);
 	m_image.def("exists", &image::exists);
+	m_image.def("create", &image::create, "width"_a, "height"_a);
+	m_image.def("load_pixels", &image::load_pixels);
+	m_image.def("set_atlas", &image::set_atlas, "enabled"_a, "page_size"_a = 1024, "max_size"_a = 256);
+	m_image.def("get_atlas_stats", &image::get_atlas_stats);
+	m_image.def("load_async", &image::load_async);
 	// gdgame.font
 	py::module m_font = m.def_submodule("font", "gdgame module for loading and rendering fonts.");
 	py::class_<GdFont>(m_font, "Font")
@@ -1035,6 +1850,9 @@ PYBIND11_EMBEDDED_MODULE(gdgame, m) {
 		.attr("__version__") = VERSION_FULL_CONFIG;
 	m_font.def("init", []() { });
 	m_font.def("quit", []() { });
+	m_font.def("set_cache_budget", [](size_t bytes) { _font_cache.set_budget(bytes); }, "bytes"_a);
+	m_font.def("get_cache_stats", []() { return _font_cache.get_stats(); });
+	m_font.def("load_async", &font::load_async, "path"_a, "size"_a, "outline_size"_a = 0, "outline_color"_a = std::vector<uint8_t>{ 0, 0, 0, 255 }, "stretch"_a = 0);
 	// gdgame.net
 	py::module m_net = m.def_submodule("net", "Network components and services.");
 	m_info.attr("STATUS_UNKNOWN") = 0;
@@ -4,17 +4,64 @@
 #include "core/os/input.h"
 #include "core/math/vector2.h"
 
+// Scoped interpreter lock for calls made from engine code (main or worker thread)
+struct PyGodotGIL {
+	int _state;
+
+	PyGodotGIL();
+	~PyGodotGIL();
+};
+
 struct PyGodotInstance {
 	struct InstancePrivateData;
 
+	// Application callbacks resolved once per application object
+	enum Callback {
+		CALLBACK_INIT,
+		CALLBACK_TICK,
+		CALLBACK_DRAW,
+		CALLBACK_EVENT,
+		CALLBACK_EVENTS,
+		CALLBACK_TERM,
+		CALLBACK_MAX
+	};
+
 	InstancePrivateData *_p;
 
+	static const char *get_callback_name(Callback p_func);
+
+	Variant pycall(Callback p_func);
+	Variant pycall(Callback p_func, real_t p_arg);
 	Variant pycall(const String &p_func);
 	Variant pycall(const String &p_func, real_t p_arg);
 
 	bool build_pygodot(int p_instance_id, const String &p_build_func);
 	void destroy_pygodot();
-	bool process_events(const Ref<InputEvent> &p_event, const String &p_event_func);
+	bool process_events(const Ref<InputEvent> &p_event);
+	bool queue_events(const Ref<InputEvent> &p_event, bool p_coalesce_motion);
+	void flush_events();
+
+	// gd_draw output is recorded and replayed with merged draw calls
+	void draw_batched();
+	// gd_draw output is split into layers, only changed layers are redrawn
+	void draw_retained();
+
+	// Coroutines started with gdgame.sched, resumed once per frame
+	void run_coroutines();
+	void resume_coroutines(int p_instance_id, const String &p_signal);
+
+	// Callbacks running past the budget are interrupted with FrameBudgetExceeded
+	void set_frame_budget(uint64_t p_usec);
+	uint64_t get_frame_budget() const;
+	Dictionary get_budget_stats() const;
+
+	// Threaded execution: gd_tick/gd_draw run on a worker thread and
+	// draw commands are replayed on the main thread
+	bool start_thread(int p_instance_id, int p_latency);
+	void stop_thread();
+	bool is_threaded() const;
+	bool sync_thread(real_t p_delta);
+	void draw_thread();
 
 	PyGodotInstance();
 	~PyGodotInstance();
@@ -0,0 +1,154 @@
+#ifndef PY_PIXELS_H
+#define PY_PIXELS_H
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define GD_PIXELS_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define GD_PIXELS_NEON
+#include <arm_neon.h>
+#endif
+
+// Row operations on RGBA8 pixels (bytes R, G, B, A - one uint32_t per pixel
+// on little endian). Blending is straight alpha "source over":
+//   rgb = (src * a + dst * (255 - a)) / 255
+//   alpha = (255 * a + dst_a * (255 - a)) / 255
+
+namespace pixels {
+
+static const uint32_t ALPHA_MASK = 0xff000000;
+static const uint32_t RGB_MASK = 0x00ffffff;
+
+// x / 255 for x in 0..65025 (exact)
+static inline uint32_t _div255(uint32_t x) {
+	return (x + 1 + (x >> 8)) >> 8;
+}
+
+static inline uint32_t _blend(uint32_t d, uint32_t s) {
+	const uint32_t a = s >> 24;
+	if (a == 255) {
+		return s;
+	} else if (a == 0) {
+		return d;
+	}
+	s |= ALPHA_MASK;
+	uint32_t r = 0;
+	for (int c = 0; c < 32; c += 8) {
+		r |= _div255(((s >> c) & 0xff) * a + ((d >> c) & 0xff) * (255 - a)) << c;
+	}
+	return r;
+}
+
+static inline void fill_row(uint32_t *dst, int count, uint32_t value) {
+	int i = 0;
+#if defined(GD_PIXELS_SSE2)
+	const __m128i v = _mm_set1_epi32(int(value));
+	for (; i + 4 <= count; i += 4) {
+		_mm_storeu_si128((__m128i *)(dst + i), v);
+	}
+#elif defined(GD_PIXELS_NEON)
+	const uint32x4_t v = vdupq_n_u32(value);
+	for (; i + 4 <= count; i += 4) {
+		vst1q_u32(dst + i, v);
+	}
+#endif
+	for (; i < count; i++) {
+		dst[i] = value;
+	}
+}
+
+static inline void copy_row(uint32_t *dst, const uint32_t *src, int count) {
+	memmove(dst, src, count * sizeof(uint32_t));
+}
+
+// Pixels with rgb equal to key are skipped
+static inline void colorkey_row(uint32_t *dst, const uint32_t *src, int count, uint32_t key) {
+	key &= RGB_MASK;
+	int i = 0;
+#if defined(GD_PIXELS_SSE2)
+	const __m128i k = _mm_set1_epi32(int(key));
+	const __m128i m = _mm_set1_epi32(int(RGB_MASK));
+	for (; i + 4 <= count; i += 4) {
+		const __m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+		const __m128i d = _mm_loadu_si128((const __m128i *)(dst + i));
+		const __m128i keep = _mm_cmpeq_epi32(_mm_and_si128(s, m), k);
+		_mm_storeu_si128((__m128i *)(dst + i), _mm_or_si128(_mm_and_si128(keep, d), _mm_andnot_si128(keep, s)));
+	}
+#elif defined(GD_PIXELS_NEON)
+	const uint32x4_t k = vdupq_n_u32(key);
+	const uint32x4_t m = vdupq_n_u32(RGB_MASK);
+	for (; i + 4 <= count; i += 4) {
+		const uint32x4_t s = vld1q_u32(src + i);
+		const uint32x4_t d = vld1q_u32(dst + i);
+		vst1q_u32(dst + i, vbslq_u32(vceqq_u32(vandq_u32(s, m), k), d, s));
+	}
+#endif
+	for (; i < count; i++) {
+		if ((src[i] & RGB_MASK) != key) {
+			dst[i] = src[i];
+		}
+	}
+}
+
+static inline void blend_row(uint32_t *dst, const uint32_t *src, int count) {
+	int i = 0;
+#if defined(GD_PIXELS_SSE2)
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i amask = _mm_set1_epi32(int(ALPHA_MASK));
+	const __m128i c255 = _mm_set1_epi16(255);
+	const __m128i one = _mm_set1_epi16(1);
+	for (; i + 4 <= count; i += 4) {
+		const __m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+		const __m128i d = _mm_loadu_si128((const __m128i *)(dst + i));
+		__m128i a = _mm_srli_epi32(s, 24); // alpha to all channels
+		a = _mm_or_si128(a, _mm_slli_epi32(a, 8));
+		a = _mm_or_si128(a, _mm_slli_epi32(a, 16));
+		const __m128i so = _mm_or_si128(s, amask);
+		__m128i r[2];
+		for (int h = 0; h < 2; h++) {
+			const __m128i s16 = h ? _mm_unpackhi_epi8(so, zero) : _mm_unpacklo_epi8(so, zero);
+			const __m128i d16 = h ? _mm_unpackhi_epi8(d, zero) : _mm_unpacklo_epi8(d, zero);
+			const __m128i a16 = h ? _mm_unpackhi_epi8(a, zero) : _mm_unpacklo_epi8(a, zero);
+			__m128i x = _mm_add_epi16(_mm_mullo_epi16(s16, a16), _mm_mullo_epi16(d16, _mm_sub_epi16(c255, a16)));
+			x = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(x, one), _mm_srli_epi16(x, 8)), 8);
+			r[h] = x;
+		}
+		_mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(r[0], r[1]));
+	}
+#elif defined(GD_PIXELS_NEON)
+	static const uint8_t _alpha_index[8] = { 3, 3, 3, 3, 7, 7, 7, 7 };
+	static const uint8_t _alpha_mask[8] = { 0, 0, 0, 255, 0, 0, 0, 255 };
+	const uint8x8_t ai = vld1_u8(_alpha_index);
+	const uint8x8_t am = vld1_u8(_alpha_mask);
+	for (; i + 2 <= count; i += 2) {
+		const uint8x8_t s = vld1_u8((const uint8_t *)(src + i));
+		const uint8x8_t d = vld1_u8((const uint8_t *)(dst + i));
+		const uint8x8_t a = vtbl1_u8(s, ai);
+		uint16x8_t x = vmull_u8(vorr_u8(s, am), a);
+		x = vmlal_u8(x, d, vmvn_u8(a));
+		// (x + 1 + (x >> 8)) >> 8
+		x = vshrq_n_u16(vaddq_u16(vaddq_u16(x, vdupq_n_u16(1)), vshrq_n_u16(x, 8)), 8);
+		vst1_u8((uint8_t *)(dst + i), vmovn_u16(x));
+	}
+#endif
+	for (; i < count; i++) {
+		dst[i] = _blend(dst[i], src[i]);
+	}
+}
+
+// 8-bit indices to colors (no gather in SSE2/NEON - plain lookup)
+static inline void palette_row(uint32_t *dst, const uint8_t *src, int count, const uint32_t *palette, int palette_size) {
+	for (int i = 0; i < count; i++) {
+		const uint8_t index = src[i];
+		if (index < palette_size) {
+			dst[i] = palette[index];
+		}
+	}
+}
+
+} // namespace pixels
+
+#endif // PY_PIXELS_H
@@ -1,12 +1,26 @@
 #include "core/engine.h"
 #include "core/class_db.h"
+#include "core/project_settings.h"
 #include "register_types.h"
 
 #include "godot_cpython.h"
 
 void register_gd_cpython_types() {
-	Engine::get_singleton()->add_singleton(Engine::Singleton("CPythonEngine", memnew(CPythonEngine)));
+	ClassDB::register_virtual_class<CPythonEngine>();
+	CPythonEngine *cpython = memnew(CPythonEngine);
+	Engine::get_singleton()->add_singleton(Engine::Singleton("CPythonEngine", cpython));
 	ClassDB::register_class<CPythonInstance>();
+
+	// start interpreter and import listed modules while the engine is loading
+	const bool background_init = GLOBAL_DEF("python/startup/background_init", false);
+	const PoolStringArray warmup_imports = GLOBAL_DEF("python/startup/warmup_imports", PoolStringArray());
+	if (background_init && !Engine::get_singleton()->is_editor_hint()) {
+		Vector<String> imports;
+		for (int i = 0; i < warmup_imports.size(); i++) {
+			imports.push_back(warmup_imports[i]);
+		}
+		cpython->start_background_init(imports);
+	}
 }
 
 void unregister_gd_cpython_types() {